@@ -0,0 +1,89 @@
+//Compares the rgba and index compositors of every instruction set supported by the cpu with the
+//scalar ones, on random layers and every window start. Returns 1 at the first difference.
+//Usage: "Compositor Test.exe" [seed] [lines]
+
+#define SDL_MAIN_HANDLED		//plain console main, SDL is only included for its types
+#include "compositor.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+static const char* isaNames[COMPOSITOR_ISA_COUNT] = { "scalar", "sse2", "avx2" };
+
+//random colours and indexes, and random transparency and priority masks
+static void randomLayer(scanline_layer& layer, std::mt19937& rng) {
+	for (int i = 0; i < 160; i++) {
+		layer.color[i] = rng();
+		layer.index[i] = (uint8_t)rng();
+		layer.priority[i] = (rng() & 0x1) ? 0xff : 0;
+		layer.trasparent[i] = (rng() & 0x1) ? 0xff : 0;
+	}
+}
+
+int main(int argc, char* argv[]) {
+
+	std::mt19937 rng((argc > 1) ? atoi(argv[1]) : 1);
+	int lines = (argc > 2) ? atoi(argv[2]) : 100000;
+
+	for (int isa = COMPOSITOR_SCALAR + 1; isa < COMPOSITOR_ISA_COUNT; isa++) {
+		if (getCompositor(isa) == nullptr)
+			std::cout << isaNames[isa] << ": not supported, skipped" << std::endl;
+		if (getIndexCompositor(isa) == nullptr)
+			std::cout << isaNames[isa] << " index: not available, skipped" << std::endl;
+	}
+
+	scanline_layer bg, window, sprites;
+	for (int line = 0; line < lines; line++) {
+		randomLayer(bg, rng);
+		randomLayer(window, rng);
+		randomLayer(sprites, rng);
+		int windowStart = line % 161;		//160 when the window is not shown
+
+		uint32_t expected[160];
+		compositeScalar(expected, bg, window, sprites, windowStart);
+		for (int isa = COMPOSITOR_SCALAR + 1; isa < COMPOSITOR_ISA_COUNT; isa++) {
+			compositor_func compositor = getCompositor(isa);
+			if (compositor == nullptr)
+				continue;
+
+			uint32_t scanline[160];
+			compositor(scanline, bg, window, sprites, windowStart);
+			for (int i = 0; i < 160; i++) {
+				if (scanline[i] == expected[i])
+					continue;
+				std::cout << isaNames[isa] << ": mismatch on line " << line << " at pixel " << i << std::hex <<
+					": 0x" << scanline[i] << " instead of 0x" << expected[i] << std::dec <<
+					" (sprite trasparent=" << (int)sprites.trasparent[i] << " priority=" << (int)sprites.priority[i] <<
+					", bg trasparent=" << (int)bg.trasparent[i] << " priority=" << (int)bg.priority[i] <<
+					", window trasparent=" << (int)window.trasparent[i] << " start=" << windowStart << ")" << std::endl;
+				return 1;
+			}
+		}
+
+		uint8_t expectedIndexes[160];
+		compositeIndexScalar(expectedIndexes, bg, window, sprites, windowStart);
+		for (int isa = COMPOSITOR_SCALAR + 1; isa < COMPOSITOR_ISA_COUNT; isa++) {
+			index_compositor_func compositor = getIndexCompositor(isa);
+			if (compositor == nullptr)
+				continue;
+
+			uint8_t scanline[160];
+			compositor(scanline, bg, window, sprites, windowStart);
+			for (int i = 0; i < 160; i++) {
+				if (scanline[i] == expectedIndexes[i])
+					continue;
+				std::cout << isaNames[isa] << " index: mismatch on line " << line << " at pixel " << i <<
+					": " << (int)scanline[i] << " instead of " << (int)expectedIndexes[i] <<
+					" (sprite trasparent=" << (int)sprites.trasparent[i] << " priority=" << (int)sprites.priority[i] <<
+					", bg trasparent=" << (int)bg.trasparent[i] << " priority=" << (int)bg.priority[i] <<
+					", window trasparent=" << (int)window.trasparent[i] << " start=" << windowStart << ")" << std::endl;
+				return 1;
+			}
+		}
+	}
+
+	std::cout << lines << " lines, no mismatch" << std::endl;
+	return 0;
+}
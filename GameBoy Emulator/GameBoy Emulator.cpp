@@ -34,10 +34,35 @@ void mainRoutine() {
 
 }
 
+//runs the rom for a number of frames as fast as possible, without window and sound,
+//and prints the frame rate. Used to compare the emulator speed between builds
+void benchmarkRoutine(const char* filename, int frames) {
+    _memory->Init(filename);
+    _ppu->Init();
+    _gameboy->Init();
+    *_sound->getSoundEnable() = false;
+
+    auto startTime = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < frames; i++) {
+        _gameboy->runFor(4194 * 16.67);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - startTime;
+
+    double fps = frames / elapsed.count();
+    std::cout << frames << " frames in " << elapsed.count() << " s: " << fps << " fps, " <<
+        fps / 60 << "x real time" << std::endl;
+}
+
 #undef main
 int main(int argc, char** argv)
 {
 
+    //GameBoy Emulator.exe --bench <rom> [frames]
+    if (argc >= 3 && std::string(argv[1]) == "--bench") {
+        benchmarkRoutine(argv[2], (argc >= 4) ? std::stoi(argv[3]) : 3600);
+        return 0;
+    }
+
     std::string filename;
 #ifdef _DEBUG
     ShowWindow(GetConsoleWindow(), SW_SHOW);
@@ -9,6 +9,7 @@
 #include <cstdint>
 #include <string.h>
 #include <string>
+#include <algorithm>
 
 uint8_t Cartridge::bank1_reg = 0;
 uint8_t Cartridge::bank2_reg = 1;
@@ -99,6 +100,7 @@ Cartridge::Cartridge(const char* rom_filename){
 		allocRamFromHeader();
 	}
 
+	updateBanks();
 }
 
 void Cartridge::allocMbc2Ram() {
@@ -291,33 +293,64 @@ void Cartridge::verifyHeader(int fileSize) {
 uint8_t Cartridge::read(uint16_t address) {
 
 	if (address >= 0xa000 && address < 0xc000) {
-		if (!ram_access)
-			return 0;
-		if (rtc) {
-			if(ram_bank > 0x7)
-				return get_RTC_reg(ram_bank);
-		}
-		return ram[ramTranslateAddr(address)];
+		if (ramWindow != nullptr)
+			return ramWindow[address & ramWindowMask];
+		if (rtcWindow)
+			return get_RTC_reg(ram_bank);
+		return 0;
 	}
 
-	return rom[romTranslateAddr(address)];
+	return romWindows[address >> 14][address & 0x3fff];
+}
+
+//offset in the rom file of a rom address (0x0 - 0x7fff) with the current banks
+uint32_t Cartridge::getRomOffset(uint16_t address) {
+	return (uint32_t)(romWindows[address >> 14] - rom) + (address & 0x3fff);
+}
+
+//host address of a rom address (0x0 - 0x7fff) with the current banks
+uint8_t* Cartridge::getRomPointer(uint16_t address) {
+	return romWindows[address >> 14] + (address & 0x3fff);
+}
+
+uint8_t* Cartridge::getRamPointer(uint16_t address) {
+	if (ramWindow == nullptr)
+		return nullptr;
+	return ramWindow + (address & ramWindowMask);
+}
+
+uint32_t Cartridge::getRomSize() {
+	return rom_mask + 1;
 }
 
 void Cartridge::write(uint16_t address, uint8_t val) {
 
 	if (address >= 0xa000 && address < 0xc000) {
-		if (!ram_access)
-			return;
-		if (rtc) {
-			if (ram_bank > 0x7)	//ignore time changes
-				return;
-		}
-		ram[ramTranslateAddr(address)] = val;
+		if (ramWindow != nullptr)		//rtc registers are read only
+			ramWindow[address & ramWindowMask] = val;
 		return;
 	}
 
 	//rom writing for MBC control
 	romWrite(address, val);
+	updateBanks();
+}
+
+//recompute the windows from the mbc registers. The banks are contiguous in the rom
+//and ram, so the translation of the first address of a window gives the whole window
+void Cartridge::updateBanks() {
+
+	romWindows[0] = rom + romTranslateAddr(0x0000);
+	romWindows[1] = rom + romTranslateAddr(0x4000);
+
+	rtcWindow = ram_access && rtc && ram_bank > 0x7;
+	if (!ram_access || rtcWindow || ram == nullptr) {
+		ramWindow = nullptr;
+		return;
+	}
+	ramWindow = ram + ramTranslateAddr(0xa000);
+	//ram smaller than a bank, like the 2 KiB ones, repeats in the window
+	ramWindowMask = std::min<uint32_t>((romWrite == mbc2_rom_write) ? 0x1ff : 0x1fff, ram_mask);
 }
 
 
@@ -71,10 +71,19 @@ public:
 	uint8_t read(uint16_t address);
 	void write(uint16_t address, uint8_t val);
 	void saveState(void);
+	uint32_t getRomOffset(uint16_t address);
+	uint8_t* getRomPointer(uint16_t address);
+	uint8_t* getRamPointer(uint16_t address);		//nullptr if the ram window is not plain memory. Small rams are mirrored
+	uint32_t getRomSize();
 	
 private:
 	uint8_t* rom;
 	uint8_t* ram;
+	//host memory of the 0x0000, 0x4000 and 0xa000 windows, updated when a mbc register is written
+	uint8_t* romWindows[2];
+	uint8_t* ramWindow;		//nullptr when the ram is disabled or a rtc register is selected
+	uint16_t ramWindowMask;		//mbc2 ram repeats every 512 bytes
+	bool rtcWindow;		//mbc3 rtc register mapped in the ram window
 	static uint8_t bank1_reg;
 	static uint8_t bank2_reg;
 	static uint8_t ram_bank;
@@ -90,6 +99,7 @@ private:
 	void allocRamFromHeader();
 	void allocMbc2Ram();
 	void loadState(void);
+	void updateBanks();
 	void verifyHeader(int fileSize);
 	uint32_t (*romTranslateAddr)(uint16_t gb_addr);
 	uint32_t(*ramTranslateAddr)(uint16_t gb_addr);
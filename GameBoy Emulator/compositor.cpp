@@ -0,0 +1,287 @@
+#include "compositor.h"
+
+#include <cstdint>
+#include <iostream>
+#include <string.h>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+#define COMPOSITOR_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+//msvc accepts the intrinsics of any instruction set in the same function
+#define COMPOSITOR_TARGET(isa)
+#else
+#define COMPOSITOR_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+void compositeScalar(uint32_t* scanline, const scanline_layer& bg, const scanline_layer& window,
+	const scanline_layer& sprites, int windowStart) {
+
+	for (int i = 0; i < 160; i++) {
+
+		if (sprites.trasparent[i]) {
+			scanline[i] = bg.color[i];
+			//window pixels
+			if (i >= windowStart) {
+				scanline[i] = window.color[i];
+			}
+			continue;
+		}
+
+		//if background has priority, the transparency is considered
+		if ((bg.priority[i] | sprites.priority[i])) {
+
+			scanline[i] = sprites.color[i];
+
+			if (!bg.trasparent[i])
+				scanline[i] = bg.color[i];
+
+			//window pixels
+			if ((i >= windowStart) & !window.trasparent[i]) {
+				scanline[i] = window.color[i];
+			}
+			continue;
+		}
+
+		//draw sprite
+		scanline[i] = sprites.color[i];
+	}
+}
+
+void compositeIndexScalar(uint8_t* scanline, const scanline_layer& bg, const scanline_layer& window,
+	const scanline_layer& sprites, int windowStart) {
+
+	for (int i = 0; i < 160; i++) {
+		bool useBg = sprites.trasparent[i] || ((bg.priority[i] | sprites.priority[i]) && !bg.trasparent[i]);
+		bool useWindow = (i >= windowStart) && (sprites.trasparent[i] || ((bg.priority[i] | sprites.priority[i]) && !window.trasparent[i]));
+		scanline[i] = useWindow ? window.index[i] : (useBg ? bg.index[i] : sprites.index[i]);
+	}
+}
+
+#ifdef COMPOSITOR_X86
+
+//byte masks of 16 pixels starting from i: the ones showing the background instead of the sprite and the ones showing the window.
+//windowStart has the sign bit flipped, so the signed compare works on the unsigned positions
+COMPOSITOR_TARGET("sse2")
+static inline void layerMasks(const scanline_layer& bg, const scanline_layer& window, const scanline_layer& sprites,
+	int i, __m128i windowStart, __m128i& useBg, __m128i& useWindow) {
+
+	__m128i spriteTrasparent = _mm_loadu_si128((const __m128i*)&sprites.trasparent[i]);
+	__m128i bgTrasparent = _mm_loadu_si128((const __m128i*)&bg.trasparent[i]);
+	__m128i windowTrasparent = _mm_loadu_si128((const __m128i*)&window.trasparent[i]);
+	__m128i priority = _mm_or_si128(_mm_loadu_si128((const __m128i*)&bg.priority[i]),
+		_mm_loadu_si128((const __m128i*)&sprites.priority[i]));
+
+	__m128i position = _mm_add_epi8(_mm_set1_epi8((char)(i ^ 0x80)),
+		_mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15));
+	__m128i beforeWindow = _mm_cmpgt_epi8(windowStart, position);
+
+	useBg = _mm_or_si128(spriteTrasparent, _mm_andnot_si128(bgTrasparent, priority));
+	useWindow = _mm_andnot_si128(beforeWindow, _mm_or_si128(spriteTrasparent, _mm_andnot_si128(windowTrasparent, priority)));
+}
+
+COMPOSITOR_TARGET("sse2")
+static inline __m128i blendMask(__m128i mask, __m128i a, __m128i b) {
+	return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+COMPOSITOR_TARGET("sse2")
+static void compositeSse2(uint32_t* scanline, const scanline_layer& bg, const scanline_layer& window,
+	const scanline_layer& sprites, int windowStart) {
+
+	__m128i start = _mm_set1_epi8((char)(windowStart ^ 0x80));
+	for (int i = 0; i < 160; i += 16) {
+		__m128i useBg, useWindow;
+		layerMasks(bg, window, sprites, i, start, useBg, useWindow);
+
+		//widen the byte masks to one per pixel
+		__m128i bgLow = _mm_unpacklo_epi8(useBg, useBg), bgHigh = _mm_unpackhi_epi8(useBg, useBg);
+		__m128i windowLow = _mm_unpacklo_epi8(useWindow, useWindow), windowHigh = _mm_unpackhi_epi8(useWindow, useWindow);
+		__m128i bgMask[4] = { _mm_unpacklo_epi16(bgLow, bgLow), _mm_unpackhi_epi16(bgLow, bgLow),
+			_mm_unpacklo_epi16(bgHigh, bgHigh), _mm_unpackhi_epi16(bgHigh, bgHigh) };
+		__m128i windowMask[4] = { _mm_unpacklo_epi16(windowLow, windowLow), _mm_unpackhi_epi16(windowLow, windowLow),
+			_mm_unpacklo_epi16(windowHigh, windowHigh), _mm_unpackhi_epi16(windowHigh, windowHigh) };
+
+		for (int j = 0; j < 4; j++) {
+			int pixel = i + j * 4;
+			__m128i color = blendMask(bgMask[j], _mm_loadu_si128((const __m128i*)&bg.color[pixel]),
+				_mm_loadu_si128((const __m128i*)&sprites.color[pixel]));
+			color = blendMask(windowMask[j], _mm_loadu_si128((const __m128i*)&window.color[pixel]), color);
+			_mm_storeu_si128((__m128i*)&scanline[pixel], color);
+		}
+	}
+}
+
+//the indexes are bytes like the masks, so 16 pixels are blended at once
+COMPOSITOR_TARGET("sse2")
+static void compositeIndexSse2(uint8_t* scanline, const scanline_layer& bg, const scanline_layer& window,
+	const scanline_layer& sprites, int windowStart) {
+
+	__m128i start = _mm_set1_epi8((char)(windowStart ^ 0x80));
+	for (int i = 0; i < 160; i += 16) {
+		__m128i useBg, useWindow;
+		layerMasks(bg, window, sprites, i, start, useBg, useWindow);
+		__m128i index = blendMask(useBg, _mm_loadu_si128((const __m128i*)&bg.index[i]),
+			_mm_loadu_si128((const __m128i*)&sprites.index[i]));
+		index = blendMask(useWindow, _mm_loadu_si128((const __m128i*)&window.index[i]), index);
+		_mm_storeu_si128((__m128i*)&scanline[i], index);
+	}
+}
+
+COMPOSITOR_TARGET("avx2")
+static void compositeAvx2(uint32_t* scanline, const scanline_layer& bg, const scanline_layer& window,
+	const scanline_layer& sprites, int windowStart) {
+
+	__m128i start = _mm_set1_epi8((char)(windowStart ^ 0x80));
+	for (int i = 0; i < 160; i += 16) {
+		__m128i useBg, useWindow;
+		layerMasks(bg, window, sprites, i, start, useBg, useWindow);
+
+		for (int j = 0; j < 2; j++) {
+			int pixel = i + j * 8;
+			//sign extension widens the byte masks to one per pixel
+			__m256i bgMask = _mm256_cvtepi8_epi32(j ? _mm_srli_si128(useBg, 8) : useBg);
+			__m256i windowMask = _mm256_cvtepi8_epi32(j ? _mm_srli_si128(useWindow, 8) : useWindow);
+			__m256i color = _mm256_blendv_epi8(_mm256_loadu_si256((const __m256i*)&sprites.color[pixel]),
+				_mm256_loadu_si256((const __m256i*)&bg.color[pixel]), bgMask);
+			color = _mm256_blendv_epi8(color, _mm256_loadu_si256((const __m256i*)&window.color[pixel]), windowMask);
+			_mm256_storeu_si256((__m256i*)&scanline[pixel], color);
+		}
+	}
+}
+
+static bool cpuHasSse2() {
+#if defined(_M_X64) || defined(__x86_64__)
+	return true;
+#elif defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+	return info[3] & (1 << 26);
+#else
+	return __builtin_cpu_supports("sse2");
+#endif
+}
+
+static bool cpuHasAvx2() {
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+		return false;
+	__cpuid(info, 1);
+	if (!(info[2] & (1 << 27)) || !(info[2] & (1 << 28)))		//osxsave and avx
+		return false;
+	if ((_xgetbv(0) & 0x6) != 0x6)		//ymm registers saved by the os
+		return false;
+	__cpuidex(info, 7, 0);
+	return info[1] & (1 << 5);
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif
+
+compositor_func getCompositor(int isa) {
+
+	switch (isa) {
+	case COMPOSITOR_SCALAR:
+		return compositeScalar;
+#ifdef COMPOSITOR_X86
+	case COMPOSITOR_SSE2:
+		return cpuHasSse2() ? compositeSse2 : nullptr;
+	case COMPOSITOR_AVX2:
+		return cpuHasAvx2() ? compositeAvx2 : nullptr;
+#endif
+	}
+	return nullptr;
+}
+
+index_compositor_func getIndexCompositor(int isa) {
+
+	switch (isa) {
+	case COMPOSITOR_SCALAR:
+		return compositeIndexScalar;
+#ifdef COMPOSITOR_X86
+	case COMPOSITOR_SSE2:
+		return cpuHasSse2() ? compositeIndexSse2 : nullptr;
+#endif
+	}
+	return nullptr;
+}
+
+#ifdef GB_COMPOSITOR_VERIFY
+static compositor_func verifiedCompositor;
+
+//runs the selected compositor and checks it against the scalar one
+static void compositeVerify(uint32_t* scanline, const scanline_layer& bg, const scanline_layer& window,
+	const scanline_layer& sprites, int windowStart) {
+
+	uint32_t expected[160];
+	compositeScalar(expected, bg, window, sprites, windowStart);
+	verifiedCompositor(scanline, bg, window, sprites, windowStart);
+	for (int i = 0; i < 160; i++) {
+		if (scanline[i] == expected[i])
+			continue;
+		std::cout << std::hex << "Compositor mismatch at pixel " << std::dec << i << std::hex <<
+			": 0x" << scanline[i] << " instead of 0x" << expected[i] <<
+			" (sprite trasparent=" << (int)sprites.trasparent[i] << " priority=" << (int)sprites.priority[i] <<
+			", bg trasparent=" << (int)bg.trasparent[i] << " priority=" << (int)bg.priority[i] <<
+			", window trasparent=" << (int)window.trasparent[i] << std::dec << " start=" << windowStart << ")" << std::endl;
+		memcpy(scanline, expected, sizeof(expected));
+		return;
+	}
+}
+
+static index_compositor_func verifiedIndexCompositor;
+
+static void compositeIndexVerify(uint8_t* scanline, const scanline_layer& bg, const scanline_layer& window,
+	const scanline_layer& sprites, int windowStart) {
+
+	uint8_t expected[160];
+	compositeIndexScalar(expected, bg, window, sprites, windowStart);
+	verifiedIndexCompositor(scanline, bg, window, sprites, windowStart);
+	for (int i = 0; i < 160; i++) {
+		if (scanline[i] == expected[i])
+			continue;
+		std::cout << "Index compositor mismatch at pixel " << i << ": " << (int)scanline[i] <<
+			" instead of " << (int)expected[i] << " (start=" << windowStart << ")" << std::endl;
+		memcpy(scanline, expected, sizeof(expected));
+		return;
+	}
+}
+#endif
+
+compositor_func selectCompositor() {
+
+	compositor_func compositor = compositeScalar;
+#ifdef COMPOSITOR_X86
+	if (cpuHasAvx2())
+		compositor = compositeAvx2;
+	else if (cpuHasSse2())
+		compositor = compositeSse2;
+#endif
+#ifdef GB_COMPOSITOR_VERIFY
+	verifiedCompositor = compositor;
+	return compositeVerify;
+#else
+	return compositor;
+#endif
+}
+
+index_compositor_func selectIndexCompositor() {
+
+	index_compositor_func compositor = compositeIndexScalar;
+#ifdef COMPOSITOR_X86
+	if (cpuHasSse2())
+		compositor = compositeIndexSse2;
+#endif
+#ifdef GB_COMPOSITOR_VERIFY
+	verifiedIndexCompositor = compositor;
+	return compositeIndexVerify;
+#else
+	return compositor;
+#endif
+}
@@ -0,0 +1,41 @@
+#ifndef COMPOSITOR_H
+#define COMPOSITOR_H
+
+#include <cstdint>
+#include "structures.h"
+
+//merges the background, window and sprite layers into the scanline. The window is shown from
+//the pixel windowStart, 160 when it's not shown
+typedef void (*compositor_func)(uint32_t* scanline, const scanline_layer& bg, const scanline_layer& window,
+	const scanline_layer& sprites, int windowStart);
+
+//instruction sets with a compositor
+enum compositor_isa {
+	COMPOSITOR_SCALAR,
+	COMPOSITOR_SSE2,
+	COMPOSITOR_AVX2,
+	COMPOSITOR_ISA_COUNT
+};
+
+//compositor for an instruction set, nullptr if the build or the cpu doesn't support it
+compositor_func getCompositor(int isa);
+
+void compositeScalar(uint32_t* scanline, const scanline_layer& bg, const scanline_layer& window,
+	const scanline_layer& sprites, int windowStart);
+
+//same as compositor_func, for the colour indexes of the layers
+typedef void (*index_compositor_func)(uint8_t* scanline, const scanline_layer& bg, const scanline_layer& window,
+	const scanline_layer& sprites, int windowStart);
+
+//index compositor for an instruction set, nullptr if the build or the cpu doesn't support it.
+//The sse2 one already blends 16 indexes at once, so avx2 has none
+index_compositor_func getIndexCompositor(int isa);
+
+void compositeIndexScalar(uint8_t* scanline, const scanline_layer& bg, const scanline_layer& window,
+	const scanline_layer& sprites, int windowStart);
+
+//fastest compositor supported by the cpu
+compositor_func selectCompositor();
+index_compositor_func selectIndexCompositor();
+
+#endif
@@ -0,0 +1,100 @@
+#include "decode_cache.h"
+#include "memory.h"
+#include "globals.h"
+
+#include <cstdint>
+#include <string.h>
+
+DecodeCache::DecodeCache() {
+	memset(wramBanks, 0, sizeof(wramBanks));
+	memset(hram, 0, sizeof(hram));
+}
+
+void DecodeCache::Init(uint32_t romSize) {
+
+	for (size_t i = 0; i < romBanks.size(); i++) {
+		free(romBanks[i]);
+	}
+	romBanks.assign(romSize / 0x4000, nullptr);
+
+	for (int i = 0; i < 8; i++) {
+		free(wramBanks[i]);
+		wramBanks[i] = nullptr;
+	}
+	memset(hram, 0, sizeof(hram));
+
+	for (size_t i = 0; i < blocks.size(); i++) {
+		free(blocks[i]);
+	}
+	blocks.clear();
+}
+
+decoded_instruction* DecodeCache::allocBank(int size) {
+	return (decoded_instruction*)calloc(size, sizeof(decoded_instruction));
+}
+
+code_block* DecodeCache::newBlock() {
+	code_block* block = (code_block*)calloc(1, sizeof(code_block));
+	blocks.push_back(block);
+	return block;
+}
+
+decoded_instruction* DecodeCache::lookup(uint16_t pc) {
+
+	if (pc < 0x8000) {		//cartridge rom
+		//the operand of the last bytes of a bank can be in another bank
+		if ((pc & 0x3fff) > 0x3ffd)
+			return nullptr;
+
+		int32_t offset = _memory->getRomOffset(pc);
+		if (offset < 0)		//bootstrap rom
+			return nullptr;
+
+		uint32_t bank = offset >> 14;
+		if (bank >= romBanks.size())
+			return nullptr;
+		if (romBanks[bank] == nullptr)
+			romBanks[bank] = allocBank(0x4000);
+		return &romBanks[bank][offset & 0x3fff];
+	}
+
+	if (pc >= 0xc000 && pc <= 0xdfff) {		//wram
+		if ((pc & 0xfff) > 0xffd)
+			return nullptr;
+
+		int bank = (pc < 0xd000) ? 0 : _memory->getWramBank();
+		if (wramBanks[bank] == nullptr)
+			wramBanks[bank] = allocBank(0x1000);
+		return &wramBanks[bank][pc & 0xfff];
+	}
+
+	if (pc >= 0xff80 && pc <= 0xfffc) {		//hram
+		return &hram[pc - 0xff80];
+	}
+
+	return nullptr;
+}
+
+void DecodeCache::invalidate(uint16_t gb_address) {
+
+	decoded_instruction* bank;
+	int offset;
+
+	if (gb_address >= 0xc000 && gb_address <= 0xdfff) {
+		bank = wramBanks[(gb_address < 0xd000) ? 0 : _memory->getWramBank()];
+		offset = gb_address & 0xfff;
+	}
+	else if (gb_address >= 0xff80 && gb_address <= 0xfffe) {
+		bank = hram;
+		offset = gb_address - 0xff80;
+	}
+	else return;
+
+	if (bank == nullptr)
+		return;
+
+	//the byte can be the opcode or the operand of an instruction up to 2 bytes before
+	for (int i = offset; i >= 0 && i > offset - 3; i--) {
+		bank[i].length = 0;
+	}
+}
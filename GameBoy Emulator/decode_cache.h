@@ -0,0 +1,53 @@
+#ifndef DECODE_CACHE_H
+#define DECODE_CACHE_H
+
+#include "gameboy.h"
+
+#include <cstdint>
+#include <vector>
+
+#define MAX_BLOCK_LENGTH 32
+
+struct code_block;
+
+//instruction fetched and decoded once
+struct decoded_instruction {
+	opcode_handler handler;		//for 0xCB opcodes this is already the prefixed opcode handler
+	uint16_t operand;
+	uint8_t opcode;
+	uint8_t length;		//instruction length in bytes. 0 if the entry is empty
+	uint8_t cycles;		//machine cycles used. For conditional branches the not taken case
+	code_block* block;		//block starting with this instruction. Rom only
+};
+
+//straight-line run of rom instructions executed without synchronizing the other components
+struct code_block {
+	decoded_instruction* instructions[MAX_BLOCK_LENGTH];
+	uint8_t length;		//number of instructions
+	uint16_t cycles;		//total machine cycles, with the last branch not taken
+	uint8_t branchCycles;		//extra machine cycles if the last branch is taken
+	bool idleLoop;		//loop on itself that only reads memory and changes registers
+};
+
+//Decoded instructions indexed by the bank and the address of the code.
+//Rom is read only so its entries never expire, the rom banks and the wram banks
+//are part of the key so switching bank doesn't require a flush.
+//Wram and hram entries are cleared when the memory is written.
+class DecodeCache {
+public:
+	DecodeCache();
+	void Init(uint32_t romSize);
+	//return the cache entry for the instruction at pc or nullptr if the code can't be cached
+	decoded_instruction* lookup(uint16_t pc);
+	void invalidate(uint16_t gb_address);
+	code_block* newBlock();
+private:
+	std::vector<decoded_instruction*> romBanks;		//0x4000 entries per bank, allocated on first use
+	decoded_instruction* wramBanks[8];		//0x1000 entries per bank. Bank 0 is 0xc000-0xcfff
+	decoded_instruction hram[0x7f];		//0xff80 - 0xfffe
+	std::vector<code_block*> blocks;
+
+	decoded_instruction* allocBank(int size);
+};
+
+#endif
@@ -0,0 +1,83 @@
+#include "frame_sink.h"
+
+#include <string.h>
+
+FrameSlots::FrameSlots() {
+	memset(frameSequence, 0, sizeof(frameSequence));
+	frameCounter = 0;
+	writeSlot = 0;
+	readySlot = 1;
+	readSlot = 2;
+}
+
+int FrameSlots::writing() {
+	return writeSlot;
+}
+
+//the producer continues in the slot the consumer doesn't use
+void FrameSlots::publish() {
+	frameSequence[writeSlot] = ++frameCounter;
+	writeSlot = readySlot.exchange(writeSlot | FRAME_READY, std::memory_order_acq_rel) & 0x3;
+}
+
+int FrameSlots::acquire() {
+	if (readySlot.load(std::memory_order_acquire) & FRAME_READY)
+		readSlot = readySlot.exchange(readSlot, std::memory_order_acq_rel) & 0x3;
+	return readSlot;
+}
+
+uint64_t FrameSlots::getSequence() {
+	return frameSequence[readSlot];
+}
+
+
+MemoryFrameSink::MemoryFrameSink() {
+	memset(buffers, 0, sizeof(buffers));
+}
+
+uint32_t* MemoryFrameSink::beginFrame(int& pitch) {
+	pitch = 160;
+	return buffers[slots.writing()];
+}
+
+void MemoryFrameSink::endFrame() {
+	slots.publish();
+}
+
+const uint32_t* MemoryFrameSink::getFrame() {
+	return buffers[slots.acquire()];
+}
+
+uint64_t MemoryFrameSink::getFrameSequence() {
+	return slots.getSequence();
+}
+
+
+MemoryIndexedFrameSink::MemoryIndexedFrameSink() {
+	memset(buffers, 0, sizeof(buffers));
+	memset(palettes, 0, sizeof(palettes));
+	readSlot = slots.acquire();
+}
+
+uint8_t* MemoryIndexedFrameSink::beginIndexedFrame(int& pitch) {
+	pitch = 160;
+	return buffers[slots.writing()];
+}
+
+void MemoryIndexedFrameSink::endIndexedFrame(const uint32_t* palette) {
+	memcpy(palettes[slots.writing()], palette, sizeof(palettes[0]));
+	slots.publish();
+}
+
+const uint8_t* MemoryIndexedFrameSink::getFrame() {
+	readSlot = slots.acquire();
+	return buffers[readSlot];
+}
+
+const uint32_t* MemoryIndexedFrameSink::getPalette() {
+	return palettes[readSlot];
+}
+
+uint64_t MemoryIndexedFrameSink::getFrameSequence() {
+	return slots.getSequence();
+}
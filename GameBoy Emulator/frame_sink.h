@@ -0,0 +1,87 @@
+#ifndef FRAME_SINK_H
+#define FRAME_SINK_H
+
+#include <cstdint>
+#include <atomic>
+
+//Destination of the frames drawn by the ppu, in pixel format rgba. The ppu writes every pixel
+//of a frame between beginFrame and endFrame, unless the sink keeps its frames
+class FrameSink {
+public:
+	virtual ~FrameSink() {}
+	virtual uint32_t* beginFrame(int& pitch) = 0;		//memory of the frame and its pitch in pixels
+	virtual void endFrame() = 0;
+	//true when the memory returned by beginFrame still has what the ppu wrote there, so the
+	//lines that didn't change since are not written and other frames can be read
+	virtual bool keepsFrames() { return false; }
+};
+
+//colours of an indexed frame: 0-31 cgb background palettes, 32-63 cgb sprite palettes, 64 blank screen
+#define INDEXED_PALETTE_SIZE 65
+#define INDEX_SPRITE 32
+#define INDEX_BLANK 64
+
+//Destination of the indexed frames, one byte per pixel: the dmg shade 0-3 or the cgb palette colour.
+//The palette has the colours of the indexes at the end of the frame, so a palette changed
+//while the frame was drawn is exact only in the rgba frames
+class IndexedFrameSink {
+public:
+	virtual ~IndexedFrameSink() {}
+	virtual uint8_t* beginIndexedFrame(int& pitch) = 0;
+	virtual void endIndexedFrame(const uint32_t* palette) = 0;
+	virtual bool keepsFrames() { return false; }		//as FrameSink::keepsFrames
+};
+
+//set in readySlot until the consumer takes the frame
+#define FRAME_READY 0x4
+
+//Three frame buffers exchanged without locks: the producer writes one, the consumer
+//reads one and readySlot has the last completed frame
+class FrameSlots {
+public:
+	FrameSlots();
+	int writing();		//slot of the frame being written
+	void publish();		//the frame written becomes the last completed one
+	int acquire();		//slot to read, the last completed frame if there is a new one
+	uint64_t getSequence();		//number of the frame acquired, starting from 1
+private:
+	uint64_t frameSequence[3];
+	uint64_t frameCounter;
+	int writeSlot, readSlot;
+	std::atomic<int> readySlot;
+};
+
+//frames in memory, for headless use
+class MemoryFrameSink : public FrameSink {
+public:
+	MemoryFrameSink();
+	uint32_t* beginFrame(int& pitch) override;
+	void endFrame() override;
+	bool keepsFrames() override { return true; }
+	//last completed frame, valid until the next call
+	const uint32_t* getFrame();
+	//a repeated number means the frame was already returned, a gap means frames were never read
+	uint64_t getFrameSequence();
+private:
+	uint32_t buffers[3][23040];
+	FrameSlots slots;
+};
+
+//indexed frames in memory, with the palette of each one
+class MemoryIndexedFrameSink : public IndexedFrameSink {
+public:
+	MemoryIndexedFrameSink();
+	uint8_t* beginIndexedFrame(int& pitch) override;
+	void endIndexedFrame(const uint32_t* palette) override;
+	bool keepsFrames() override { return true; }
+	const uint8_t* getFrame();		//last completed frame, valid until the next call
+	const uint32_t* getPalette();		//palette of the frame returned by getFrame
+	uint64_t getFrameSequence();
+private:
+	uint8_t buffers[3][23040];
+	uint32_t palettes[3][INDEXED_PALETTE_SIZE];
+	FrameSlots slots;
+	int readSlot;
+};
+
+#endif
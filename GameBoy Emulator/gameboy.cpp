@@ -8,6 +8,7 @@
 #include "globals.h"
 #include "memory.h"
 #include "ppu.h"
+#include "decode_cache.h"
 
 #include <iostream>
 #include <fstream>
@@ -15,10 +16,35 @@
 #include <string.h>
 #include <thread>
 #include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <climits>
 
+//machine cycles of an interrupt dispatch followed by the longest instruction
+#define MAX_STEP_CYCLES 11
 
-GameBoy::GameBoy(){
+#define EVENT_NEVER UINT64_MAX
+
+//profiler hooks, compiled out without GB_PROFILE
+#ifdef GB_PROFILE
+#define PROFILE(call) profiler->call
+#else
+#define PROFILE(call)
+#endif
 
+//slower timer rates can't overflow twice during an instruction, so they are scheduled on the overflow.
+//Halted steps are shorter than any rate, so while halted the fastest one is scheduled on the overflow too
+#define TIMER_DEFER_MIN_DIVIDER 64
+
+GameBoy::GameBoy(){
+	decodeCache = new DecodeCache();
+	deferring = false;
+	blockExit = false;
+	pendingCycles = 0;
+	joypadUpdated = true;
+#ifdef GB_PROFILE
+	profiler = new Profiler();
+#endif
 }
 
 bool GameBoy::Init() {
@@ -30,12 +56,20 @@ bool GameBoy::Init() {
 
 	//init mem
 	memset(&registers, 0, sizeof(registers));
+	unpackFlags(0);
 	registers.pc = 0;
 
 	//init joypad stuff
 	registers.joyp_stat = 1;
 	joypadStatus = {};
 
+	decodeCache->Init(_memory->getRomSize());
+	pendingCycles = 0;
+	eventsChanged = true;
+#ifdef GB_PROFILE
+	profiler->Init(_memory->getRomSize());
+#endif
+
 	return true;
 }
 
@@ -44,6 +78,20 @@ bool GameBoy::Init() {
 }*/
 
 
+//called on memory writes to ram that can contain code
+void GameBoy::invalidateCode(uint16_t gb_address) {
+	decodeCache->invalidate(gb_address);
+}
+
+#ifdef GB_PROFILE
+void GameBoy::saveProfile() {
+	if (profiler->save("profile.txt", "profile.folded", opcodeTable, prefixedOpcodeTable))
+		_renderer->showMessage("Profile saved!", 2);
+	else
+		_renderer->showMessage("Unable to save the profile.", 2);
+}
+#endif
+
 void GameBoy::setClockSpeed(float multiplier) {
 	clockSpeed = multiplier;
 }
@@ -51,35 +99,74 @@ void GameBoy::setClockSpeed(float multiplier) {
 void GameBoy::runFor(int cycles) {
 
 	joypadStatus = _input->getJoypadState();		//get joypad state
+	joypadUpdated = true;
+	idleStats = {};
 	int clk = 0;
-	while (clk < cycles*clockSpeed) {
-		clk += nextInstruction();
+	int limit = (int)ceil(cycles*clockSpeed);
+	while (clk < limit) {
+		clk += nextInstruction(limit - clk);
 	}
+	flushPending();
+	lastIdleStats = idleStats;
+	_memory->handleSaveRequest();
 	_sound->UpdateSound(_memory->getIOMap());
 }
 
-int GameBoy::nextInstruction() {
+idle_stats GameBoy::getIdleStats() {
+	return lastIdleStats;
+}
+
+//execute the next instruction, or the next block if the budget (clock cycles left to run) allows it
+int GameBoy::nextInstruction(int budget) {
 
 	unsigned int m_cycles = 0;
 	IO_map* io = _memory->getIOMap();
 
+	//blocks run only when no interrupt can be serviced before their end
+	if (budget > 1 && !registers.halted && !registers.stopped && registers.IME_CC == 0 &&
+		!joypadUpdated && !(registers.IME && (io->IF & io->IE))) {
+
+		code_block* block = getBlock(registers.pc);
+		if (block != nullptr) {
+			int cycles = runBlock(*block, budget);
+			if (cycles > 0)
+				return cycles;
+		}
+	}
+
+	//instructions that can't reach the next event run without synchronizing the devices
+	if (!registers.halted && !registers.stopped && !joypadUpdated && cyclesToNextEvent() >= MAX_STEP_CYCLES) {
+		blockExit = false;
+		deferring = true;
+		m_cycles = handleInterrupt();
+		m_cycles += this->execute();
+		pendingCycles += m_cycles;
+		deferring = false;
+		if (blockExit)		//devices synchronized by the instruction
+			flushPending();
+		return (m_cycles * 4) >> doubleSpeed;
+	}
+
+	flushPending();
+
+	if (registers.halted) {
+		int cycles = skipHalt(budget);
+		if (cycles > 0)
+			return cycles;
+	}
+
 	m_cycles = handleInterrupt();
 	int cycles;
 
 	if (!registers.halted && !registers.stopped) {
 		m_cycles += this->execute();
 		cycles = (m_cycles * 4) >> doubleSpeed;
-
-		//update divider register at a rate of 16384Hz 
-		registers.div_cnt += cycles;
-		if (registers.div_cnt >= 256) {
-			registers.div_cnt -= 256;
-			io->DIV++;
-		}
+		updateDivider(cycles);
 	}
 	else {
 		m_cycles += 1;		//lcd and the timer still need the clock to work in halt mode
 		cycles = (m_cycles * 4) >> doubleSpeed;
+		PROFILE(halt(1));
 
 		//double speed
 		if (_GBC_Mode && (io->KEY1 & 0x1)) {
@@ -89,7 +176,21 @@ int GameBoy::nextInstruction() {
 		}
 	}
 
+	syncDevices(m_cycles, cycles);
+	return cycles;
+}
+
+//update divider register at a rate of 16384Hz 
+void GameBoy::updateDivider(int cycles) {
+	int div_cnt = registers.div_cnt + cycles;
+	_memory->getIOMap()->DIV += div_cnt / 256;
+	registers.div_cnt = div_cnt % 256;
+}
+
+//run joypad, serial, timer and ppu for the cycles used by the cpu
+void GameBoy::syncDevices(unsigned int m_cycles, int cycles) {
 	handleJoypad();
+	joypadUpdated = false;
 	if (!registers.stopped) {
 		handleSerial();
 		handleTimer(m_cycles * 4);
@@ -97,9 +198,332 @@ int GameBoy::nextInstruction() {
 	}
 
 	registers.clock_cnt += m_cycles * 4;
+	eventsChanged = true;
+}
+
+//run the devices for the cycles executed without synchronizing them
+void GameBoy::flushPending() {
+	if (pendingCycles > 0) {
+		int cycles = (pendingCycles * 4) >> doubleSpeed;
+		updateDivider(cycles);
+		syncDevices(pendingCycles, cycles);
+		pendingCycles = 0;
+	}
+}
+
+//return the block starting at pc or nullptr if the code can't be run as a block
+code_block* GameBoy::getBlock(uint16_t pc) {
+
+	//only rom code is run in blocks since it can't be modified
+	if (pc >= 0x8000)
+		return nullptr;
+
+	decoded_instruction* instr = decodeCache->lookup(pc);
+	if (instr == nullptr)
+		return nullptr;
+	if (instr->block == nullptr)
+		instr->block = buildBlock(pc);
+	return instr->block;
+}
+
+code_block* GameBoy::buildBlock(uint16_t pc) {
+
+	code_block* block = decodeCache->newBlock();
+	uint16_t addr = pc;
+
+	while (block->length < MAX_BLOCK_LENGTH) {
+		//a block never leaves the rom bank it starts in
+		if ((addr & 0xc000) != (pc & 0xc000))
+			break;
+		decoded_instruction* instr = decodeCache->lookup(addr);
+		if (instr == nullptr)
+			break;
+		if (instr->length == 0)
+			decode(addr, *instr);
+
+		block->instructions[block->length++] = instr;
+		block->cycles += instr->cycles;
+		addr += instr->length;
+
+		if (isBlockEnd(*instr, block->branchCycles))
+			break;
+	}
+	block->idleLoop = isIdleLoop(*block, pc, addr);
+	return block;
+}
+
+//true if the block jumps to itself and has no effect other than changing the registers.
+//If an iteration doesn't change the registers, the next ones are the same until an event
+bool GameBoy::isIdleLoop(const code_block& block, uint16_t pc, uint16_t end) {
+
+	const decoded_instruction& last = *block.instructions[block.length - 1];
+	uint16_t target;
+	switch (last.opcode) {
+	case 0x18: case 0x20: case 0x28: case 0x30: case 0x38:		//JR, JR cc
+		target = end + (int8_t)(last.operand & 0xff);
+		break;
+	case 0xc3: case 0xc2: case 0xca: case 0xd2: case 0xda:		//JP, JP cc
+		target = last.operand;
+		break;
+	default:
+		return false;
+	}
+	if (target != pc)
+		return false;
+
+	for (int i = 0; i < block.length - 1; i++) {
+		uint8_t op = block.instructions[i]->opcode;
+
+		if (op >= 0x40 && op <= 0xbf) {		//LD r, r and ALU A, r
+			if ((op & 0xf8) == 0x70)		//LD (HL), r and HALT
+				return false;
+			continue;
+		}
+		if (op == 0xcb) {		//BIT on anything, the others only on registers
+			uint8_t cb_op = block.instructions[i]->operand & 0xff;
+			if ((cb_op & 0xc0) != 0x40 && (cb_op & 0x7) == REG_HL_IND)
+				return false;
+			continue;
+		}
+		switch (op) {
+		case 0x00:		//NOP
+		case 0x06: case 0x0e: case 0x16: case 0x1e: case 0x26: case 0x2e: case 0x3e:		//LD r, d8
+		case 0x04: case 0x0c: case 0x14: case 0x1c: case 0x24: case 0x2c: case 0x3c:		//INC r
+		case 0x05: case 0x0d: case 0x15: case 0x1d: case 0x25: case 0x2d: case 0x3d:		//DEC r
+		case 0x03: case 0x13: case 0x23: case 0x33: case 0x0b: case 0x1b: case 0x2b: case 0x3b:		//INC rr, DEC rr
+		case 0x0a: case 0x1a: case 0x2a: case 0x3a:		//LD A, (rr)
+		case 0x07: case 0x0f: case 0x17: case 0x1f: case 0x27: case 0x2f: case 0x37: case 0x3f:		//RLCA, RRCA, RLA, RRA, DAA, CPL, SCF, CCF
+		case 0xc6: case 0xce: case 0xd6: case 0xde: case 0xe6: case 0xee: case 0xf6: case 0xfe:		//ALU A, d8
+		case 0xf0: case 0xf2: case 0xfa:		//LDH A, (a8), LD A, (C), LD A, (a16)
+			continue;
+		}
+		return false;
+	}
+	return true;
+}
+
+//true if the instruction must be the last of a block: branches, instructions that change the
+//interrupt state and writes to io or mbc registers. branchCycles is set to the extra cycles of a taken branch
+bool GameBoy::isBlockEnd(const decoded_instruction& instr, uint8_t& branchCycles) {
+
+	branchCycles = 0;
+	switch (instr.opcode) {
+	case 0x20: case 0x28: case 0x30: case 0x38:		//JR cc
+	case 0xc2: case 0xca: case 0xd2: case 0xda:		//JP cc
+		branchCycles = 1;
+		return true;
+	case 0xc4: case 0xcc: case 0xd4: case 0xdc:		//CALL cc
+	case 0xc0: case 0xc8: case 0xd0: case 0xd8:		//RET cc
+		branchCycles = 3;
+		return true;
+	case 0x18: case 0xc3: case 0xe9: case 0xcd: case 0xc9: case 0xd9:		//JR, JP, JP HL, CALL, RET, RETI
+	case 0xc7: case 0xcf: case 0xd7: case 0xdf: case 0xe7: case 0xef: case 0xf7: case 0xff:		//RST
+	case 0x10: case 0x76: case 0xf3: case 0xfb:		//STOP, HALT, DI, EI
+	case 0xd3: case 0xdb: case 0xdd: case 0xe3: case 0xe4: case 0xeb:		//invalid opcodes
+	case 0xec: case 0xed: case 0xf4: case 0xfc: case 0xfd:
+	case 0xe2:		//LD (C), A
+		return true;
+	case 0xe0:		//LDH (a8), A
+		return (instr.operand & 0xff) < 0x80 || (instr.operand & 0xff) == 0xff;
+	case 0xea:		//LD (a16), A
+		return instr.operand < 0x8000 || (instr.operand >= 0xff00 && (instr.operand < 0xff80 || instr.operand == 0xffff));
+	}
+	return false;
+}
+
+//find the next state change of the timer and the ppu.
+//Their state only changes when they are synchronized, so the events are updated only after a synchronization
+void GameBoy::scheduleEvents() {
+	IO_map* io_map = _memory->getIOMap();
+	uint64_t now = registers.clock_cnt;
+
+	eventClock[EVENT_TIMER] = EVENT_NEVER;
+	if (io_map->TAC & 0x4) {
+		int div_flag = (io_map->TAC & 0x3);
+		int divider = (div_flag == 0) ? 1024 : (4 << (div_flag * 2));
+		int next_step = std::max(divider - registers.timer_clk, 0);
+
+		if (timerSingleStep(divider))
+			eventClock[EVENT_TIMER] = now + next_step;
+		else
+			eventClock[EVENT_TIMER] = now + next_step + (uint64_t)(0xff - io_map->TIMA) * divider;
+	}
+
+	//the ppu clock is halved in double speed mode
+	int ppu_cycles = _ppu->cyclesToNextEvent();
+	eventClock[EVENT_PPU] = (ppu_cycles == INT_MAX) ? EVENT_NEVER : now + ((uint64_t)ppu_cycles << doubleSpeed);
+
+	nextEventClock = eventClock[0];
+	for (int i = 1; i < EVENT_COUNT; i++)
+		nextEventClock = std::min(nextEventClock, eventClock[i]);
+	eventsChanged = false;
+}
+
+//machine cycles that can be executed before the next event, counting the ones not synchronized yet
+int GameBoy::cyclesToNextEvent() {
+	if (eventsChanged)
+		scheduleEvents();
+
+	uint64_t now = registers.clock_cnt + pendingCycles * 4;
+
+	if (nextEventClock <= now)
+		return 0;
+	return (int)std::min<uint64_t>((nextEventClock - now - 1) / 4, INT_MAX);
+}
+
+//Run a block without synchronizing the other components after every instruction.
+//Instructions are executed only while no scheduled event can happen, so the devices state
+//can't change and they are run once the next event is near.
+//Writes to io registers synchronize the devices before the register changes (see syncPending)
+//and end the block. Returns the clock cycles used, 0 if the block couldn't start
+int GameBoy::runBlock(const code_block& block, int budget) {
+
+	int limit = cyclesToNextEvent();
+	int startLimit = ((budget << doubleSpeed) + 3) / 4;		//an instruction can start only before this machine cycle
+	bool fits = (block.cycles + block.branchCycles <= limit) && (block.cycles < startLimit);
+	int m_cycles;
+
+	struct registers start;
+	if (block.idleLoop)
+		start = registers;
+
+	blockExit = false;
+	deferring = true;
+
+	m_cycles = interpretBlock(block, fits, limit, startLimit);
+
+	deferring = false;
+	if (blockExit)		//devices synchronized by the instruction
+		flushPending();
+	else if (block.idleLoop && fits && sameCpuState(start, registers))
+		m_cycles += skipIdleLoop(block, startLimit - m_cycles);
+	return (m_cycles * 4) >> doubleSpeed;
+}
+
+//Skip the iterations of an idle loop that would run before the next event, as if they were run as blocks.
+//The memory it reads can't change until then, except the divider and the timer.
+//Returns the machine cycles skipped
+int GameBoy::skipIdleLoop(const code_block& block, int startLimit) {
+
+	uint16_t addresses[] = { registers.bc, registers.de, registers.hl, (uint16_t)(0xff00 | registers.c) };
+	for (uint16_t addr : addresses) {
+		if (addr == 0xff04 || addr == 0xff05)
+			return 0;
+	}
+	for (int i = 0; i < block.length; i++) {
+		const decoded_instruction* instr = block.instructions[i];
+		if ((instr->opcode == 0xf0 && ((instr->operand & 0xff) == 0x04 || (instr->operand & 0xff) == 0x05)) ||
+			(instr->opcode == 0xfa && (instr->operand == 0xff04 || instr->operand == 0xff05)))
+			return 0;
+	}
+
+	//an iteration runs as a block only if it fits before the event and starts before the budget ends
+	int loop_cycles = block.cycles + block.branchCycles;
+	int iterations = std::min(cyclesToNextEvent() / loop_cycles,
+		(startLimit - block.cycles + loop_cycles - 1) / loop_cycles);
+	if (iterations <= 0)
+		return 0;
+
+	int m_cycles = iterations * loop_cycles;
+	pendingCycles += m_cycles;
+	PROFILE(loop(registers.pc, block.instructions, block.length, block.branchCycles, iterations));
+	idleStats.pollCycles += (m_cycles * 4) >> doubleSpeed;
+	return m_cycles;
+}
+
+//While halted with no interrupt to service nothing changes until the next event,
+//so the devices run up to it at once. Returns the clock cycles skipped
+int GameBoy::skipHalt(int budget) {
+	IO_map* io = _memory->getIOMap();
+
+	if (registers.stopped || registers.IME_CC != 0 || joypadUpdated || (registers.IME && (io->IF & io->IE)) ||
+		(_GBC_Mode && (io->KEY1 & 0x1)))
+		return 0;
+
+	//a halted step uses one machine cycle and runs until the budget ends
+	int m_cycles = std::min(cyclesToNextEvent(), ((budget << doubleSpeed) + 3) / 4);
+	if (m_cycles <= 1)
+		return 0;
+
+	int cycles = (m_cycles * 4) >> doubleSpeed;
+	syncDevices(m_cycles, cycles);
+	idleStats.haltCycles += cycles;
+	PROFILE(halt(m_cycles));
 	return cycles;
 }
 
+//registers visible to the code and the cpu state
+bool GameBoy::sameCpuState(const struct registers& r1, const struct registers& r2) {
+	uint8_t flag1 = packFlags(r1.flags), flag2 = packFlags(r2.flags);
+	return r1.a == r2.a && r1.bc == r2.bc && r1.de == r2.de && r1.hl == r2.hl &&
+		flag1 == flag2 && r1.pc == r2.pc && r1.sp == r2.sp &&
+		r1.IME == r2.IME && r1.IME_CC == r2.IME_CC && r1.halted == r2.halted && r1.stopped == r2.stopped;
+}
+
+//run the block instructions with their handlers. Returns the machine cycles used
+int GameBoy::interpretBlock(const code_block& block, bool fits, int limit, int startLimit) {
+
+	int m_cycles = 0;
+	for (int i = 0; i < block.length; i++) {
+		const decoded_instruction* instr = block.instructions[i];
+
+		if (!fits) {
+			int worst = instr->cycles + ((i == block.length - 1) ? block.branchCycles : 0);
+			if (m_cycles + worst > limit || m_cycles >= startLimit)
+				break;
+		}
+
+#ifdef GB_PROFILE
+		uint16_t pc = registers.pc;
+#endif
+		registers.pc += instr->length;
+		int used = (this->*instr->handler)(instr->operand);
+		PROFILE(instruction(pc, *instr, used, registers));
+		m_cycles += used;
+		pendingCycles += used;
+
+		if (blockExit)
+			break;
+	}
+	return m_cycles;
+}
+
+//called by the memory before a write to io or mbc registers
+void GameBoy::syncPending() {
+	if (!deferring)
+		return;
+
+	//the instructions completed so far are synchronized with the old register values
+	flushPending();
+	blockExit = true;
+}
+
+//DIV and TIMA values including the cycles not synchronized yet
+uint8_t GameBoy::readDivider() {
+	int cycles = (pendingCycles * 4) >> doubleSpeed;
+	return _memory->getIOMap()->DIV + (registers.div_cnt + cycles) / 256;
+}
+
+uint8_t GameBoy::readTimer() {
+	IO_map* io_map = _memory->getIOMap();
+
+	if (!(io_map->TAC & 0x4))
+		return io_map->TIMA;
+
+	//single step rates have their next increment scheduled, so it can't be pending.
+	//For the other rates the overflow is scheduled
+	int div_flag = (io_map->TAC & 0x3);
+	int divider = (div_flag == 0) ? 1024 : (4 << (div_flag * 2));
+	if (timerSingleStep(divider))
+		return io_map->TIMA;
+	return io_map->TIMA + (registers.timer_clk + pendingCycles * 4) / divider;
+}
+
+//The fastest rate (unless halted) and a counter that is late after a rate change
+//advance by one increment per step, so each increment is scheduled
+bool GameBoy::timerSingleStep(int divider) {
+	return (divider < TIMER_DEFER_MIN_DIVIDER && !registers.halted) || registers.timer_clk >= divider;
+}
 
 void GameBoy::handleTimer(int cycles) {
 	IO_map* io_map = _memory->getIOMap();
@@ -107,18 +531,23 @@ void GameBoy::handleTimer(int cycles) {
 	if (!(io_map->TAC & 0x4))
 		return;
 
-	registers.timer_clk += cycles;
 	int div_flag = (io_map->TAC & 0x3);
 	int divider = (div_flag == 0) ? 1024 : (4 << (div_flag*2));
-	if (registers.timer_clk >= divider) {
-		registers.timer_clk -= divider;
+
+	//deferred cycles can contain more increments, except for the single step rates
+	bool single_step = timerSingleStep(divider);
+	int timer_clk = registers.timer_clk + cycles;
+	while (timer_clk >= divider) {
+		timer_clk -= divider;
 		io_map->TIMA++;
 		if (io_map->TIMA == 0) {	//overflow
 			io_map->TIMA = io_map->TMA;		//reload timer
 			io_map->IF |= 0x4;		//timer IRQ asserted
 		}
+		if (single_step)
+			break;
 	}
-	
+	registers.timer_clk = timer_clk;
 }
 
 void GameBoy::handleJoypad(void) {
@@ -174,6 +603,7 @@ int GameBoy::handleInterrupt(void) {
 			if ((io_map->IF & (0x1 << i)) && (io_map->IE & (0x1 << i))) {
 				registers.halted = 0;
 				registers.stopped = 0;
+				eventsChanged = true;		//the timer schedule depends on the halted state
 
 				uint16_t interrupt_vect_addr = 0x40 + 0x8 * i;
 				//PUSH PC
@@ -184,6 +614,7 @@ int GameBoy::handleInterrupt(void) {
 				registers.IME = 0;		//disable interrupt
 				io_map->IF &= ~(0x1 << i);	//clear interrupt flag
 				registers.pc = interrupt_vect_addr;		//jump to the corrisponding interrupt vector
+				PROFILE(interrupt(interrupt_vect_addr, registers.sp, 5));
 				return 5;
 			}
 		}
@@ -202,2547 +633,1306 @@ void GameBoy::handleSerial(void) {
 	
 }
 
-//execute an instruction, update the pc and return the number of cycles used
-int GameBoy::execute() {
+//read and decode the instruction at gb_address
+void GameBoy::decode(uint16_t gb_address, decoded_instruction& instr) {
 
-	uint16_t pc = registers.pc;
+	uint8_t opcode = _memory->read(gb_address);
+	const opcode_info& op = opcodeTable[opcode];
 
-	uint8_t opcode = _memory->read(pc);
+	instr.opcode = opcode;
+	instr.operand = 0;
+	if (op.length > 1) instr.operand = _memory->read(gb_address + 1);
+	if (op.length > 2) instr.operand |= (_memory->read(gb_address + 2) << 8);
+	instr.length = op.length;
+	instr.handler = op.handler;
+	instr.cycles = op.cycles;
 
-	switch (opcode) {
-	case 0x0:		//NOP
-	{
-		registers.pc += 1;
-		return 1;
-	}
-	case 0x1:		//LD BD, d16
-	{
-		registers.c = _memory->read(pc + 1);
-		registers.b = _memory->read(pc + 2);
-		registers.pc += 3;
-		return 3;
-	}
-	case 0x02:		//LD (BC), A
-	{
-		uint16_t bc = (registers.b << 8) | registers.c;
-		_memory->write(bc, registers.a);
-		registers.pc += 1;
-		return 2;
-	}
-	case 0x3:		//INC BC
-	{
-		uint16_t bc = (registers.b << 8) | registers.c;
-		bc++;
-		registers.b = (bc >> 8) & 0xff;
-		registers.c = bc & 0xff;
-		registers.pc += 1;
-		return 2;
+	if (opcode == 0xcb) {		//resolve the prefixed opcode now
+		const opcode_info& cb_op = prefixedOpcodeTable[instr.operand & 0xff];
+		instr.handler = cb_op.handler;
+		instr.cycles = cb_op.cycles;
 	}
-	case 0x4:		//INC B
-	{
-		registers.flag.h = ((registers.b & 0xf) == 0xf);
+}
+
+//execute an instruction, update the pc and return the number of cycles used
+int GameBoy::execute() {
 
-		registers.b++;
-		registers.flag.z = (registers.b == 0);
-		registers.flag.n = 0;
+	decoded_instruction uncached;
+	decoded_instruction* instr = decodeCache->lookup(registers.pc);
 
-		registers.pc += 1;
-		return 1;
-	}
-	case 0x5:		//DEC B
-	{
-		registers.flag.h = ((registers.b & 0xf) == 0);	//needs a half carry?
-
-		registers.b--;
-		registers.flag.z = (registers.b == 0);
-		registers.flag.n = 1;
-		
-		registers.pc += 1;
-		return 1;
-	}
-	case 0x6:		//LD B, d8
-	{
-		registers.b = _memory->read(pc + 1);
-		registers.pc += 2;
-		return 2;
+	if (instr == nullptr) {		//code in a region that is not cached
+		instr = &uncached;
+		decode(registers.pc, *instr);
 	}
-	case 0x7:		//RLCA
-	{
-		registers.flag.c = ((registers.a & 0x80) != 0);
-		registers.a <<= 1;
-		registers.a |= registers.flag.c;
-		registers.flag.n = 0;
-		registers.flag.h = 0;
-		registers.flag.z = 0;
-
-		registers.pc += 1;
-		return 1;
+	else if (instr->length == 0) {		//first execution
+		decode(registers.pc, *instr);
 	}
-	case 0x08:		//LD (a16), SP
-	{
-		uint16_t gb_addr = (_memory->read(pc + 1) | _memory->read(pc + 2) << 8);
-		_memory->write(gb_addr, registers.sp & 0xff);
-		_memory->write(gb_addr + 1, (registers.sp >> 8) & 0xff);
-		registers.pc += 3;
-		return 5;
-	}
-	case 0x9:		//ADD HL, BC
-	{
-		uint16_t bc = (registers.b << 8) | registers.c;
-		uint16_t hl = (registers.h << 8) | registers.l;
-		uint32_t sum = hl + bc;
 
-		registers.flag.h = (((hl & 0xfff) + (bc & 0xfff)) > 0xfff);
+	//the handlers find the pc already pointing to the next instruction
+#ifdef GB_PROFILE
+	uint16_t pc = registers.pc;
+#endif
+	registers.pc += instr->length;
+	uint16_t operand = instr->operand;
+
+	int m_cycles = (this->*instr->handler)(operand);
+	PROFILE(instruction(pc, *instr, m_cycles, registers));
+	return m_cycles;
+}
 
-		hl += bc;
+//0xCB prefix. The operand is the prefixed opcode
+int GameBoy::prefixed_execute(uint16_t operand) {
+	return (this->*prefixedOpcodeTable[operand & 0xff].handler)(operand);
+}
 
-		registers.flag.n = 0;
-		registers.flag.c = (sum > 0xffff);
+//F register from the flags of the last operation
+uint8_t GameBoy::packFlags(const lazy_flags& flags) {
+	uint8_t f = (flags.result == 0) ? FLAG_Z : 0;
+	if (flags.carry)
+		f |= FLAG_C;
 
-		registers.h = (hl >> 8) & 0xff;
-		registers.l = hl & 0xff;
-		registers.pc += 1;
-		return 2;
-	}
-	case 0xa:		//LD A, (BC)
-	{
-		uint16_t bc = (registers.b << 8) | registers.c;
-		registers.a = _memory->read(bc);
-		registers.pc += 1;
-		return 2;
+	switch (flags.op) {
+	case FLAGS_NH: f |= flags.x; break;
+	case FLAGS_ADD: if (flags.x + flags.y > 0xf) f |= FLAG_H; break;
+	case FLAGS_SUB: f |= FLAG_N | ((flags.x < flags.y) ? FLAG_H : 0); break;
+	case FLAGS_INC: if ((flags.result & 0xf) == 0) f |= FLAG_H; break;
+	case FLAGS_DEC: f |= FLAG_N | (((flags.result & 0xf) == 0xf) ? FLAG_H : 0); break;
 	}
-	case 0xb:		//DEC BC
-	{
-		uint16_t bc = (registers.b << 8) | registers.c;
-		bc--;
-		registers.b = (bc >> 8) & 0xff;
-		registers.c = bc & 0xff;
-		registers.pc += 1;
-		return 2;
-	}
-	case 0xc:		//INC C
-	{
-		registers.flag.h = ((registers.c & 0xf) == 0xf);
-
-		registers.c++;
-		registers.flag.z = (registers.c == 0);
-		registers.flag.n = 0;
-		
-		registers.pc += 1;
-		return 1;
-	}
-	case 0xd:		//DEC C
-	{
-		registers.flag.h = ((registers.c & 0xf) == 0);	//needs a half carry?
+	return f;
+}
 
-		registers.c--;
-		registers.flag.z = (registers.c == 0);
-		registers.flag.n = 1;
+void GameBoy::unpackFlags(uint8_t f) {
+	registers.flags.result = !(f & FLAG_Z);
+	registers.flags.carry = (f & FLAG_C) != 0;
+	registers.flags.op = FLAGS_NH;
+	registers.flags.x = f & (FLAG_N | FLAG_H);
+}
 
-		registers.pc += 1;
-		return 1;
-	}
-	case 0xe:	//LD C, d8
-	{
-		registers.c = _memory->read(pc + 1);
-		registers.pc += 2;
-		return 2;
-	}
-	case 0xf:		//RRCA
-	{
-		registers.flag.c = ((registers.a & 0x1) != 0);
-		registers.a >>= 1;
-		registers.a |= (registers.flag.c << 7);
-		registers.flag.n = 0;
-		registers.flag.h = 0;
-		registers.flag.z = 0;
-		
-		registers.pc += 1;
-		return 1;
-	}
-	case 0x10:		//STOP d8
-	{
-		registers.stopped = true;
-		_sound->Halt();
-		registers.pc += 2;
-		return 1;
-	}
-	case 0x11:		//LD DE, d16
-	{
-		registers.e = _memory->read(pc + 1);
-		registers.d = _memory->read(pc + 2);
-		registers.pc += 3;
-		return 3;
-	}
-	case 0x12:		//LD (DE), A
-	{
-		uint16_t de = (registers.d << 8) | registers.e;
-		_memory->write(de, registers.a);
-		registers.pc += 1;
-		return 2;
-	}
-	case 0x13:		//INC DE
-	{
-		uint16_t de = (registers.d << 8) | registers.e;
-		de++;
-		registers.d = (de >> 8) & 0xff;
-		registers.e = de & 0xff;
-		registers.pc += 1;
-		return 2;
-	}
-	case 0x14:		//INC D
-	{
-		registers.flag.h = ((registers.d & 0xf) == 0xf);
+//Z from the result, N and H as in the F register
+inline void GameBoy::setFlags(uint8_t result, uint8_t nh, uint8_t carry) {
+	registers.flags.result = result;
+	registers.flags.carry = carry;
+	registers.flags.op = FLAGS_NH;
+	registers.flags.x = nh;
+}
 
-		registers.d++;
-		registers.flag.z = (registers.d == 0);
-		registers.flag.n = 0;
+template <int r>
+uint8_t GameBoy::readReg8(uint16_t operand) {
+	if constexpr (r == REG_B) return registers.b;
+	else if constexpr (r == REG_C) return registers.c;
+	else if constexpr (r == REG_D) return registers.d;
+	else if constexpr (r == REG_E) return registers.e;
+	else if constexpr (r == REG_H) return registers.h;
+	else if constexpr (r == REG_L) return registers.l;
+	else if constexpr (r == REG_HL_IND) return _memory->read(readReg16<REG_HL>());
+	else if constexpr (r == REG_A) return registers.a;
+	else return operand & 0xff;		//d8
+}
 
-		registers.pc += 1;
-		return 1;
-	}
-	case 0x15:		//DEC D
-	{
-		registers.flag.h = ((registers.d & 0xf) == 0);	//needs a half carry?
+template <int r>
+void GameBoy::writeReg8(uint8_t value) {
+	if constexpr (r == REG_B) registers.b = value;
+	else if constexpr (r == REG_C) registers.c = value;
+	else if constexpr (r == REG_D) registers.d = value;
+	else if constexpr (r == REG_E) registers.e = value;
+	else if constexpr (r == REG_H) registers.h = value;
+	else if constexpr (r == REG_L) registers.l = value;
+	else if constexpr (r == REG_HL_IND) _memory->write(readReg16<REG_HL>(), value);
+	else if constexpr (r == REG_A) registers.a = value;
+}
 
-		registers.d--;
-		registers.flag.z = (registers.d == 0);
-		registers.flag.n = 1;
+template <int rr>
+uint16_t GameBoy::readReg16() {
+	if constexpr (rr == REG_BC) return registers.bc;
+	else if constexpr (rr == REG_DE) return registers.de;
+	else if constexpr (rr == REG_HL) return registers.hl;
+	else if constexpr (rr == REG_SP) return registers.sp;
+	else return (registers.a << 8) | packFlags(registers.flags);		//AF
+}
 
-		registers.pc += 1;
-		return 1;
+template <int rr>
+void GameBoy::writeReg16(uint16_t value) {
+	if constexpr (rr == REG_BC) {
+		registers.bc = value;
 	}
-	case 0x16:		//LD D, d8
-	{
-		registers.d = _memory->read(pc + 1);
-		registers.pc += 2;
-		return 2;
+	else if constexpr (rr == REG_DE) {
+		registers.de = value;
 	}
-	case 0x17:		//RLA
-	{
-		uint8_t bit0 = registers.flag.c;
-		registers.flag.c = ((registers.a & 0x80) != 0);
-		registers.a <<= 1;
-		registers.a |= bit0;
-		registers.flag.n = 0;
-		registers.flag.h = 0;
-		registers.flag.z = 0;
-
-		registers.pc += 1;
-		return 1;
+	else if constexpr (rr == REG_HL) {
+		registers.hl = value;
 	}
-	case 0x18:		//JR d8
-	{
-		char jump = _memory->read(pc + 1);
-		registers.pc = (unsigned)((short)registers.pc + jump);
-		registers.pc += 2;
-		return 3;
+	else if constexpr (rr == REG_SP) {
+		registers.sp = value;
+	}
+	else {		//AF
+		registers.a = (value >> 8) & 0xff;
+		unpackFlags(value & 0xff);
 	}
-	case 0x19:		//ADD HL, DE
-	{
-		uint16_t de = (registers.d << 8) | registers.e;
-		uint16_t hl = (registers.h << 8) | registers.l;
-		uint32_t sum = hl + de;
+}
 
-		registers.flag.h = (((hl & 0xfff) + (de & 0xfff)) > 0xfff);
+template <int cc>
+bool GameBoy::checkCondition() {
+	if constexpr (cc == COND_NZ) return registers.flags.result != 0;
+	else if constexpr (cc == COND_Z) return registers.flags.result == 0;
+	else if constexpr (cc == COND_NC) return !registers.flags.carry;
+	else if constexpr (cc == COND_C) return registers.flags.carry;
+	else return true;
+}
 
-		hl += de;
+void GameBoy::push(uint16_t value) {
+	_memory->write(registers.sp - 1, (value >> 8) & 0xff);
+	_memory->write(registers.sp - 2, value & 0xff);
+	registers.sp -= 2;
+}
 
-		registers.flag.n = 0;
-		registers.flag.c = (sum > 0xffff);
+uint16_t GameBoy::pop() {
+	uint16_t value = (_memory->read(registers.sp) | (_memory->read(registers.sp + 1) << 8));
+	registers.sp += 2;
+	return value;
+}
 
-		registers.h = (hl >> 8) & 0xff;
-		registers.l = hl & 0xff;
-		registers.pc += 1;
-		return 2;
-	}
-	case 0x1a:		//LD A, (DE)
-	{
-		uint16_t de = (registers.d << 8) | registers.e;
-		registers.a = _memory->read(de);
-		registers.pc += 1;
-		return 2;
-	}
-	case 0x1b:		//DEC DE
-	{
-		uint16_t de = (registers.d << 8) | registers.e;
-		de--;
-		registers.d = (de >> 8) & 0xff;
-		registers.e = de & 0xff;
-
-		registers.pc += 1;
-		return 2;
-	}
-	case 0x1c:		//INC E
-	{
-		registers.flag.h = ((registers.e & 0xf) == 0xf);
+int GameBoy::NOP(uint16_t operand) {
+	return 1;
+}
 
-		registers.e++;
-		registers.flag.z = (registers.e == 0);
-		registers.flag.n = 0;
+int GameBoy::STOP(uint16_t operand) {
+	registers.stopped = true;
+	_sound->Halt();
+	return 1;
+}
 
-		registers.pc += 1;
-		return 1;
+int GameBoy::HALT(uint16_t operand) {
+	if (registers.IME) {		//interrupt are enabled
+		registers.halted = 1;
+		eventsChanged = true;
 	}
-	case 0x1d:		//DEC E
-	{
-		registers.flag.h = ((registers.e & 0xf) == 0);	//needs a half carry?
+	return 1;
+}
 
-		registers.e--;
-		registers.flag.z = (registers.e == 0);
-		registers.flag.n = 1;
+int GameBoy::DI(uint16_t operand) {
+	registers.IME_U = 0;
+	registers.IME_CC = 2;
+	return 1;
+}
 
-		registers.pc += 1;
-		return 1;
-	}
-	case 0x1e:		//LD E, d8
-	{
-		registers.e = _memory->read(pc + 1);
-		registers.pc += 2;
-		return 2;
-	}
-	case 0x1f:		//RRA
-	{
-		uint8_t bit7 = registers.flag.c;
-		registers.flag.c = ((registers.a & 0x1) != 0);
-		registers.a >>= 1;
-		registers.a |= (bit7 << 7);
-		registers.flag.n = 0;
-		registers.flag.h = 0;
-		registers.flag.z = 0;
-
-		registers.pc += 1;
-		return 1;
-	}
-	case 0x20:		//JR NZ, d8
-	{
-		char jump = _memory->read(pc + 1);
-		if (!registers.flag.z) {
-			registers.pc = (unsigned)((short)registers.pc + jump);
-			registers.pc += 2;
-			return 3;
-		}
-		registers.pc += 2;
-		return 2;
-	}
+int GameBoy::EI(uint16_t operand) {
+	registers.IME_U = 1;
+	registers.IME_CC = 2;
+	return 1;
+}
 
-	case 0x21:		//LD HL, d16
-	{
-		registers.l = _memory->read(pc + 1);
-		registers.h = _memory->read(pc + 2);
-		registers.pc += 3;
-		return 3;
-	}
-	case 0x22:		//LD (HL+), A
-	{
-		uint16_t hl = (registers.h << 8) | registers.l;
-		_memory->write(hl, registers.a);
-		hl++;
-		registers.h = (hl >> 8) & 0xff;
-		registers.l = hl & 0xff;
-		registers.pc += 1;
-		return 2;
-	}
-	case 0x23:		//INC HL
-	{
-		uint16_t hl = (registers.h << 8) | registers.l;
-		hl++;
-		registers.h = (hl >> 8) & 0xff;
-		registers.l = hl & 0xff;
-		registers.pc += 1;
-		return 2;
-	}
-	case 0x24:		//INC H
-	{
-		registers.flag.h = ((registers.h & 0xf) == 0xf);
+int GameBoy::INVALID(uint16_t operand) {
+	uint16_t pc = registers.pc - 1;
+	char opcode_str[8];
+	snprintf(opcode_str, sizeof(opcode_str), "0x%02x", _memory->read(pc));
+	fatal(FATAL_INVALID_OPCODE, __func__, "\nOpcode: " + std::string(opcode_str) + "\nPC = " + std::to_string(pc));
+	return 0;
+}
 
-		registers.h++;
-		registers.flag.z = (registers.h == 0);
-		registers.flag.n = 0;
+template <int r>
+int GameBoy::LD_r_d8(uint16_t operand) {
+	writeReg8<r>(operand & 0xff);
+	return (r == REG_HL_IND) ? 3 : 2;
+}
 
-		registers.pc += 1;
-		return 1;
-	}
-	case 0x25:		//DEC H
-	{
-		registers.flag.h = ((registers.h & 0xf) == 0);	//needs a half carry?
+template <int r1, int r2>
+int GameBoy::LD_r_r(uint16_t operand) {
+	writeReg8<r1>(readReg8<r2>(operand));
+	return (r1 == REG_HL_IND || r2 == REG_HL_IND) ? 2 : 1;
+}
 
-		registers.h--;
-		registers.flag.z = (registers.h == 0);
-		registers.flag.n = 1;
+template <int rr>
+int GameBoy::LD_rr_d16(uint16_t operand) {
+	writeReg16<rr>(operand);
+	return 3;
+}
 
-		registers.pc += 1;
-		return 1;
-	}
-	case 0x26:		//LD H, d8
-	{
-		registers.h = _memory->read(pc + 1);
-		registers.pc += 2;
-		return 2;
-	}
-	case 0x27:		//DAA
-	{
-		uint8_t &a = registers.a;
-		uint8_t cf = registers.flag.c;
-
-		if (registers.flag.n) {		//subtraction in last math instruction
-			//4 lower nibbles greater than 9
-			if (((a & 0xf) > 9) || registers.flag.h) {
-				registers.flag.c |= (a < 6);
-				a -= 6;
-			}
-			//4 upper nibbles greater than 9
-			if ((a > 0x9f) || cf) {
-				a -= 0x60;
-				registers.flag.c = 1;
-			}
-			else {
-				registers.flag.c = 0;
-			}
-		}
-		else {
-			//4 lower nibbles greater than 9
-			if (((a & 0xf) > 9) || registers.flag.h) {
-				registers.flag.c |= (((uint16_t)a + 6) > 0xff);
-				a += 6;
-			}
+template <int rr>
+int GameBoy::LD_pRR_A(uint16_t operand) {
+	_memory->write(readReg16<rr>(), registers.a);
+	return 2;
+}
 
-			//4 upper nibbles greater than 9
-			if ((a > 0x9f) || cf) {
-				registers.flag.c = 1;
-				a += 0x60;
-			}
-			else {
-				registers.flag.c = 0;
-			}
-		}
+template <int rr>
+int GameBoy::LD_A_pRR(uint16_t operand) {
+	registers.a = _memory->read(readReg16<rr>());
+	return 2;
+}
 
-		registers.flag.z = (registers.a == 0);
-		registers.flag.h = 0;
-		registers.pc += 1;
-		return 1;
-	}
-	case 0x28:		//JR Z, d8
-	{
-		char jump = _memory->read(pc + 1);
-		if (registers.flag.z) {
-			registers.pc = (unsigned)((short)registers.pc + jump);
-			registers.pc += 2;
-			return 3;
-		}
-		registers.pc += 2;
-		return 2;
-	}
-	case 0x29:		//ADD HL, HL
-	{
-		uint16_t hl = (registers.h << 8) | registers.l;
-		uint32_t sum = hl + hl;
-
-		registers.flag.h = (((hl & 0xfff) + (hl & 0xfff)) > 0xfff);
-		hl += hl;
-		registers.flag.n = 0;
-		registers.flag.c = (sum > 0xffff);
-
-		registers.h = (hl >> 8) & 0xff;
-		registers.l = hl & 0xff;
-		registers.pc += 1;
-		return 2;
-	}
-	case 0x2a:		//LD A, (HL+)
-	{
-		uint16_t hl = (registers.h << 8) | registers.l;
-		registers.a = _memory->read(hl);
-		hl++;
-		registers.h = (hl >> 8) & 0xff;
-		registers.l = hl & 0xff;
-		registers.pc += 1;
-		return 2;
-	}
-	case 0x2b:		//DEC HL
-	{
-		uint16_t hl = (registers.h << 8) | registers.l;
-		hl--;
-		registers.h = (hl >> 8) & 0xff;
-		registers.l = hl & 0xff;
-		registers.pc += 1;
-		return 2;
-	}
-	case 0x2c:		//INC L
-	{
-		registers.flag.h = ((registers.l & 0xf) == 0xf);
+int GameBoy::LD_HLI_A(uint16_t operand) {
+	uint16_t hl = readReg16<REG_HL>();
+	_memory->write(hl, registers.a);
+	writeReg16<REG_HL>(hl + 1);
+	return 2;
+}
 
-		registers.l++;
-		registers.flag.z = (registers.l == 0);
-		registers.flag.n = 0;
+int GameBoy::LD_HLD_A(uint16_t operand) {
+	uint16_t hl = readReg16<REG_HL>();
+	_memory->write(hl, registers.a);
+	writeReg16<REG_HL>(hl - 1);
+	return 2;
+}
 
-		registers.pc += 1;
-		return 1;
-	}
-	case 0x2d:		//DEC L
-	{
-		registers.flag.h = ((registers.l & 0xf) == 0);	//needs a half carry?
+int GameBoy::LD_A_HLI(uint16_t operand) {
+	uint16_t hl = readReg16<REG_HL>();
+	registers.a = _memory->read(hl);
+	writeReg16<REG_HL>(hl + 1);
+	return 2;
+}
 
-		registers.l--;
-		registers.flag.z = (registers.l == 0);
-		registers.flag.n = 1;
+int GameBoy::LD_A_HLD(uint16_t operand) {
+	uint16_t hl = readReg16<REG_HL>();
+	registers.a = _memory->read(hl);
+	writeReg16<REG_HL>(hl - 1);
+	return 2;
+}
 
-		registers.pc += 1;
-		return 1;
-	}
-	case 0x2e:		//LD L, d8
-	{
-		registers.l = _memory->read(pc + 1);
-		registers.pc += 2;
-		return 2;
-	}
-	case 0x2f:		//CPL
-	{
-		registers.a = ~registers.a;
-		registers.flag.n = 1;
-		registers.flag.h = 1;
-		registers.pc += 1;
-		return 1;
-	}
-	case 0x30:		//JR NC d8
-	{
-		char jump = _memory->read(pc + 1);
-		if (!registers.flag.c) {
-			registers.pc = (unsigned)((short)registers.pc + jump);
-			registers.pc += 2;
-			return 3;
-		}
-		registers.pc += 2;
-		return 2;
-	}
-	case 0x31:		//LD SP, d16
-	{
-		registers.sp = (_memory->read(pc + 1) | _memory->read(pc + 2) << 8);
-		registers.pc += 3;
-		return 3;
-	}
-	case 0x32:		//LD (HL-), A
-	{
-		uint16_t hl = (registers.h << 8) | registers.l;
-		_memory->write(hl, registers.a);
-		hl--;
-		registers.h = (hl >> 8) & 0xff;
-		registers.l = hl & 0xff;
-		registers.pc += 1;
-		return 2;
-	}
-	case 0x33:		//INC SP
-	{
-		registers.sp++;
-		registers.pc += 1;
-		return 2;
-	}
-	case 0x34:		//INC (HL)
-	{
-		uint16_t hl = (registers.h << 8) | registers.l;
-		uint8_t n = _memory->read(hl);
-
-		registers.flag.h = ((n & 0xf) == 0xf);
-		n++;
-		registers.flag.z = (n == 0);
-		registers.flag.n = 0;
-		_memory->write(hl, n);
-
-		registers.pc += 1;
-		return 3;
-	}
-	case 0x35:		//DEC (HL)
-	{
-		uint16_t hl = (registers.h << 8) | registers.l;
-		uint8_t n = _memory->read(hl);
-
-		registers.flag.h = ((n & 0xf) == 0);	//needs a half carry?
-		n--;
-		registers.flag.z = (n == 0);
-		registers.flag.n = 1;
-		_memory->write(hl, n);
-
-		registers.pc += 1;
-		return 3;
-	}
-	case 0x36:		//LD (HL), d8
-	{
-		uint16_t hl = (registers.h << 8) | registers.l;
-		uint8_t n = _memory->read(pc + 1);
-		_memory->write(hl, n);
+int GameBoy::LD_a16_SP(uint16_t operand) {
+	_memory->write(operand, registers.sp & 0xff);
+	_memory->write(operand + 1, (registers.sp >> 8) & 0xff);
+	return 5;
+}
 
-		registers.pc += 2;
-		return 3;
-	}
-	case 0x37:		//SCF
-	{
-		registers.flag.c = 1;
-		registers.flag.n = 0;
-		registers.flag.h = 0;
-		registers.pc += 1;
-		return 1;
-	}
-	case 0x38:		//JR C d8
-	{
-		char jump = _memory->read(pc + 1);
-		if (registers.flag.c) {
-			registers.pc = (unsigned)((short)registers.pc + jump);
-			registers.pc += 2;
-			return 3;
-		}
-		registers.pc += 2;
-		return 2;
-	}
-	case 0x39:		//ADD HL, SP
-	{
-		uint16_t hl = (registers.h << 8) | registers.l;
-		uint32_t sum = hl + registers.sp;
-
-		registers.flag.h = (((hl & 0xfff) + (registers.sp & 0xfff)) > 0xfff);
-		hl += registers.sp;
-		registers.flag.n = 0;
-		registers.flag.c = (sum > 0xffff);
-
-		registers.h = (hl >> 8) & 0xff;
-		registers.l = hl & 0xff;
-		registers.pc += 1;
-		return 2;
-	}
-	case 0x3a:		//LD A, (HL-)
-	{
-		uint16_t hl = (registers.h << 8) | registers.l;
-		registers.a = _memory->read(hl);
-		hl--;
-		registers.h = (hl >> 8) & 0xff;
-		registers.l = hl & 0xff;
-		registers.pc += 1;
-		return 2;
-	}
-	case 0x3b:		//DEC SP
-	{
-		registers.sp--;
-		registers.pc += 1;
-		return 2;
-	}
-	case 0x3c:		//INC A
-	{
-		registers.flag.h = ((registers.a & 0xf) == 0xf);
+int GameBoy::LDH_a8_A(uint16_t operand) {
+	_memory->write(0xff00 + (operand & 0xff), registers.a);
+	return 3;
+}
 
-		registers.a++;
-		registers.flag.z = (registers.a == 0);
-		registers.flag.n = 0;
+int GameBoy::LDH_A_a8(uint16_t operand) {
+	registers.a = _memory->read(0xff00 + (operand & 0xff));
+	return 3;
+}
 
-		registers.pc += 1;
-		return 1;
-	}
-	case 0x3d:		//DEC A
-	{
-		registers.flag.h = ((registers.a & 0xf) == 0);	//needs a half carry?
+int GameBoy::LD_pC_A(uint16_t operand) {
+	_memory->write(0xff00 + registers.c, registers.a);
+	return 2;
+}
 
-		registers.a--;
-		registers.flag.z = (registers.a == 0);
-		registers.flag.n = 1;
+int GameBoy::LD_A_pC(uint16_t operand) {
+	registers.a = _memory->read(0xff00 + registers.c);
+	return 2;
+}
 
-		registers.pc += 1;
-		return 1;
-	}
-	case 0x3e:		//LD A, d8
-	{
-		registers.a = _memory->read(pc + 1);
-		registers.pc += 2;
-		return 2;
-	}
-	case 0x3f:		//CCF
-	{
-		registers.flag.c = ~registers.flag.c;
-		registers.flag.n = 0;
-		registers.flag.h = 0;
-		registers.pc += 1;
-		return 1;
-	}
-	case 0x40:		//LD B, B
-	{
-		return LD_r1_r2(registers.b, registers.b);
-	}
-	case 0x41:		//LD B, C
-	{
-		return LD_r1_r2(registers.b, registers.c);
-	}
-	case 0x42:		//LD B, D
-	{
-		return LD_r1_r2(registers.b, registers.d);
-	}
-	case 0x43:		//LD B, E
-	{
-		return LD_r1_r2(registers.b, registers.e);
-	}
-	case 0x44:		//LD B, H
-	{
-		return LD_r1_r2(registers.b, registers.h);
-	}
-	case 0x45:		//LD B, L
-	{
-		return LD_r1_r2(registers.b, registers.l);
-	}
-	case 0x46:		//LD B, (HL)
-	{
-		uint16_t hl = (registers.h << 8) | registers.l;
-		registers.b = _memory->read(hl);
-		registers.pc += 1;
-		return 2;
-	}
-	case 0x47:		//LD B, A
-	{
-		return LD_r1_r2(registers.b, registers.a);
-	}
-	case 0x48:		//LD C, B
-	{
-		return LD_r1_r2(registers.c, registers.b);
-	}
-	case 0x49:		//LD C, C
-	{
-		return LD_r1_r2(registers.c, registers.c);
-	}
-	case 0x4a:		//LD C, D
-	{
-		return LD_r1_r2(registers.c, registers.d);
-	}
-	case 0x4b:		//LD C, E
-	{
-		return LD_r1_r2(registers.c, registers.e);
-	}
-	case 0x4c:		//LD C, H
-	{
-		return LD_r1_r2(registers.c, registers.h);
-	}
-	case 0x4d:		//LD C, L
-	{
-		return LD_r1_r2(registers.c, registers.l);
-	}
-	case 0x4e:		//LD C, (HL)
-	{
-		uint16_t hl = (registers.h << 8) | registers.l;
-		registers.c = _memory->read(hl);
-		registers.pc += 1;
-		return 2;
-	}
-	case 0x4f:		//LD C, A
-	{
-		return LD_r1_r2(registers.c, registers.a);
-	}
+int GameBoy::LD_a16_A(uint16_t operand) {
+	_memory->write(operand, registers.a);
+	return 4;
+}
 
-	case 0x50:		//LD D, B
-	{
-		return LD_r1_r2(registers.d, registers.b);
-	}
-	case 0x51:		//LD D, C
-	{
-		return LD_r1_r2(registers.d, registers.c);
-	}
-	case 0x52:		//LD D, D
-	{
-		return LD_r1_r2(registers.d, registers.d);
-	}
-	case 0x53:		//LD D, E
-	{
-		return LD_r1_r2(registers.d, registers.e);
-	}
-	case 0x54:		//LD D, H
-	{
-		return LD_r1_r2(registers.d, registers.h);
-	}
-	case 0x55:		//LD D, L
-	{
-		return LD_r1_r2(registers.d, registers.l);
-	}
-	case 0x56:		//LD D, (HL)
-	{
-		uint16_t hl = (registers.h << 8) | registers.l;
-		registers.d = _memory->read(hl);
-		registers.pc += 1;
-		return 2;
-	}
-	case 0x57:		//LD D, A
-	{
-		return LD_r1_r2(registers.d, registers.a);
-	}
+int GameBoy::LD_A_a16(uint16_t operand) {
+	registers.a = _memory->read(operand);
+	return 4;
+}
 
-	case 0x58:		//LD E, B
-	{
-		return LD_r1_r2(registers.e, registers.b);
-	}
-	case 0x59:		//LD E, C
-	{
-		return LD_r1_r2(registers.e, registers.c);
-	}
-	case 0x5a:		//LD E, D
-	{
-		return LD_r1_r2(registers.e, registers.d);
-	}
-	case 0x5b:		//LD E, E
-	{
-		return LD_r1_r2(registers.e, registers.e);
-	}
-	case 0x5c:		//LD E, H
-	{
-		return LD_r1_r2(registers.e, registers.h);
-	}
-	case 0x5d:		//LD E, L
-	{
-		return LD_r1_r2(registers.e, registers.l);
-	}
-	case 0x5e:		//LD E, (HL)
-	{
-		uint16_t hl = (registers.h << 8) | registers.l;
-		registers.e = _memory->read(hl);
-		registers.pc += 1;
-		return 2;
-	}
-	case 0x5f:		//LD E, A
-	{
-		return LD_r1_r2(registers.e, registers.a);
-	}
-	case 0x60:		//LD H, B
-	{
-		return LD_r1_r2(registers.h, registers.b);
-	}
-	case 0x61:		//LD H, C
-	{
-		return LD_r1_r2(registers.h, registers.c);
-	}
-	case 0x62:		//LD H, D
-	{
-		return LD_r1_r2(registers.h, registers.d);
-	}
-	case 0x63:		//LD H, E
-	{
-		return LD_r1_r2(registers.h, registers.e);
-	}
-	case 0x64:		//LD H, H
-	{
-		return LD_r1_r2(registers.h, registers.h);
-	}
-	case 0x65:		//LD H, L
-	{
-		return LD_r1_r2(registers.h, registers.l);
-	}
-	case 0x66:		//LD H, (HL)
-	{
-		uint16_t hl = (registers.h << 8) | registers.l;
-		registers.h = _memory->read(hl);
-		registers.pc += 1;
-		return 2;
-	}
-	case 0x67:		//LD H, A
-	{
-		return LD_r1_r2(registers.h, registers.a);
-	}
-	case 0x68:		//LD L, B
-	{
-		return LD_r1_r2(registers.l, registers.b);
-	}
-	case 0x69:		//LD L, C
-	{
-		return LD_r1_r2(registers.l, registers.c);
-	}
-	case 0x6a:		//LD L, D
-	{
-		return LD_r1_r2(registers.l, registers.d);
-	}
-	case 0x6b:		//LD L, E
-	{
-		return LD_r1_r2(registers.l, registers.e);
-	}
-	case 0x6c:		//LD L, H
-	{
-		return LD_r1_r2(registers.l, registers.h);
-	}
-	case 0x6d:		//LD L, L
-	{
-		return LD_r1_r2(registers.l, registers.l);
-	}
-	case 0x6e:		//LD L, (HL)
-	{
-		uint16_t hl = (registers.h << 8) | registers.l;
-		registers.l = _memory->read(hl);
-		registers.pc += 1;
-		return 2;
-	}
-	case 0x6f:		//LD L, A
-	{
-		return LD_r1_r2(registers.l, registers.a);
-	}
-	case 0x70:		//LD (HL), B
-	{
-		uint16_t hl = (registers.h << 8) | registers.l;
-		_memory->write(hl, registers.b);
+int GameBoy::LD_HL_SP_r8(uint16_t operand) {
+	uint8_t n = operand & 0xff;
+	uint16_t hl = registers.sp + n;
 
-		registers.pc += 1;
-		return 2;
-	}
-	case 0x71:		//LD (HL), C
-	{
-		uint16_t hl = (registers.h << 8) | registers.l;
-		_memory->write(hl, registers.c);
+	setFlags(1, (((registers.sp & 0xf) + (n & 0xf)) > 0xf) ? FLAG_H : 0, ((registers.sp & 0xff) + n) > 0xff);
 
-		registers.pc += 1;
-		return 2;
-	}
-	case 0x72:		//LD (HL), D
-	{
-		uint16_t hl = (registers.h << 8) | registers.l;
-		_memory->write(hl, registers.d);
+	writeReg16<REG_HL>(hl);
+	return 3;
+}
 
-		registers.pc += 1;
-		return 2;
-	}
-	case 0x73:		//LD (HL), E
-	{
-		uint16_t hl = (registers.h << 8) | registers.l;
-		_memory->write(hl, registers.e);
+int GameBoy::LD_SP_HL(uint16_t operand) {
+	registers.sp = readReg16<REG_HL>();
+	return 2;
+}
 
-		registers.pc += 1;
-		return 2;
-	}
-	case 0x74:		//LD (HL), H
-	{
-		uint16_t hl = (registers.h << 8) | registers.l;
-		_memory->write(hl, registers.h);
+template <int rr>
+int GameBoy::PUSH_rr(uint16_t operand) {
+	push(readReg16<rr>());
+	return 4;
+}
 
-		registers.pc += 1;
-		return 2;
-	}
-	case 0x75:		//LD (HL), L
-	{
-		uint16_t hl = (registers.h << 8) | registers.l;
-		_memory->write(hl, registers.l);
+template <int rr>
+int GameBoy::POP_rr(uint16_t operand) {
+	writeReg16<rr>(pop());
+	return 3;
+}
 
-		registers.pc += 1;
-		return 2;
-	}
-	case 0x76:		//HALT
-	{
-		if (registers.IME) {		//interrupt are enabled
-			registers.halted = 1;
-		}
-		registers.pc += 1;
-		return 1;
-	}
-	case 0x77:		//LD (HL), A
-	{
-		uint16_t hl = (registers.h << 8) | registers.l;
-		_memory->write(hl, registers.a);
-		
-		registers.pc += 1;
-		return 2;
-	}
-	case 0x78:		//LD A, B
-	{
-		return LD_r1_r2(registers.a, registers.b);
-	}
-	case 0x79:		//LD A, C
-	{
-		return LD_r1_r2(registers.a, registers.c);
-	}
-	case 0x7a:		//LD A, D
-	{
-		return LD_r1_r2(registers.a, registers.d);
-	}
-	case 0x7b:		//LD A, E
-	{
-		return LD_r1_r2(registers.a, registers.e);
-	}
-	case 0x7c:		//LD A, H
-	{
-		return LD_r1_r2(registers.a, registers.h);
-	}
-	case 0x7d:		//LD A, L
-	{
-		return LD_r1_r2(registers.a, registers.l);
-	}
-	case 0x7e:		//LD A, (HL)
-	{
-		uint16_t hl = (registers.h << 8) | registers.l;
-		registers.a = _memory->read(hl);
-		registers.pc += 1;
-		return 2;
-	}
-	case 0x7f:		//LD A, A
-	{
-		return LD_r1_r2(registers.a, registers.a);
-	}
-	case 0x80:		//ADD A, B
-	{
-		return ADD_n(registers.b);
-	}
-	case 0x81:		//ADD A, C
-	{
-		return ADD_n(registers.c);
-	}
-	case 0x82:		//ADD A, D
-	{
-		return ADD_n(registers.d);
-	}
-	case 0x83:		//ADD A, E
-	{
-		return ADD_n(registers.e);
-	}
-	case 0x84:		//ADD A, H
-	{
-		return ADD_n(registers.h);
-	}
-	case 0x85:		//ADD A, L
-	{
-		return ADD_n(registers.l);
-	}
-	case 0x86:		//ADD A, (HL)
-	{
-		uint16_t hl = (registers.h << 8) | registers.l;
-		uint8_t n = _memory->read(hl);
-		ADD_n(n);
-		return 2;
-	}
-	case 0x87:		//ADD A
-	{
-		return ADD_n(registers.a);
-	}
-	case 0x88:		//ADC A, B
-	{
-		return ADC_A_n(registers.b);
-	}
-	case 0x89:		//ADC A, C
-	{
-		return ADC_A_n(registers.c);
-	}
-	case 0x8a:		//ADC A, D
-	{
-		return ADC_A_n(registers.d);
-	}
-	case 0x8b:		//ADC A, E
-	{
-		return ADC_A_n(registers.e);
-	}
-	case 0x8c:		//ADC A, H
-	{
-		return ADC_A_n(registers.h);
-	}
-	case 0x8d:		//ADC A, L
-	{
-		return ADC_A_n(registers.l);
-	}
-	case 0x8e:		//ADC A, (HL)
-	{
-		uint16_t hl = (registers.h << 8) | registers.l;
-		uint8_t n = _memory->read(hl);
-		ADC_A_n(n);
-		return 2;
-	}
-	case 0x8f:		//ADC A, A
-	{
-		return ADC_A_n(registers.a);
-	}
-	case 0x90:		//SUB B
-	{
-		return SUB_n(registers.b);
-	}
-	case 0x91:		//SUB C
-	{
-		return SUB_n(registers.c);
-	}
-	case 0x92:		//SUB D
-	{
-		return SUB_n(registers.d);
-	}
-	case 0x93:		//SUB E
-	{
-		return SUB_n(registers.e);
-	}
-	case 0x94:		//SUB H
-	{
-		return SUB_n(registers.h);
-	}
-	case 0x95:		//SUB L
-	{
-		return SUB_n(registers.l);
-	}
-	case 0x96:		//SUB (HL)
-	{
-		uint16_t hl = (registers.h << 8) | registers.l;
-		uint8_t n = _memory->read(hl);
-		SUB_n(n);
-		return 2;
-	}
-	case 0x97:		//SUB A
-	{
-		return SUB_n(registers.a);
-	}
-	case 0x98:		//SBC A, B
-	{
-		return SBC_A_n(registers.b);
-	}
-	case 0x99:		//SBC A, C
-	{
-		return SBC_A_n(registers.c);
-	}
-	case 0x9a:		//SBC A, D
-	{
-		return SBC_A_n(registers.d);
-	}
-	case 0x9b:		//SBC A, E
-	{
-		return SBC_A_n(registers.e);
-	}
-	case 0x9c:		//SBC A, H
-	{
-		return SBC_A_n(registers.h);
-	}
-	case 0x9d:		//SBC A, L
-	{
-		return SBC_A_n(registers.l);
-	}
-	case 0x9e:		//SBC A, (HL)
-	{
-		uint16_t hl = (registers.h << 8) | registers.l;
-		uint8_t n = _memory->read(hl);
-		SBC_A_n(n);
-		return 2;
-	}
-	case 0x9f:		//SBC A, A
-	{
-		return SBC_A_n(registers.a);
-	}
-	case 0xa0:		//AND B
-	{
-		return AND_n(registers.b);
-	}
-	case 0xa1:		//AND C
-	{
-		return AND_n(registers.c);
-	}
-	case 0xa2:		//AND D
-	{
-		return AND_n(registers.d);
-	}
-	case 0xa3:		//AND E
-	{
-		return AND_n(registers.e);
-	}
-	case 0xa4:		//AND H
-	{
-		return AND_n(registers.h);
-	}
-	case 0xa5:		//AND L
-	{
-		return AND_n(registers.l);
-	}
-	case 0xa6:		//AND (HL)
-	{
-		uint16_t hl = (registers.h << 8) | registers.l;
-		uint8_t n = _memory->read(hl);
-		AND_n(n);
-		return 2;
-	}
-	case 0xa7:		//AND A
-	{
-		return AND_n(registers.a);
-	}
-	case 0xa8:		//XOR B
-	{
-		return XOR_n(registers.b);
-	}
-	case 0xa9:		//XOR C
-	{
-		return XOR_n(registers.c);
-	}
-	case 0xaa:		//XOR D
-	{
-		return XOR_n(registers.d);
-	}
-	case 0xab:		//XOR E
-	{
-		return XOR_n(registers.e);
-	}
-	case 0xac:		//XOR H
-	{
-		return XOR_n(registers.h);
-	}
-	case 0xad:		//XOR L
-	{
-		return XOR_n(registers.l);
-	}
-	case 0xae:		//XOR (HL)
-	{
-		uint16_t hl = (registers.h << 8) | registers.l;
-		uint8_t n = _memory->read(hl);
-		XOR_n(n);
-		return 2;
-	}
-	case 0xaf:		//XOR A
-	{
-		return XOR_n(registers.a);
-	}
-	case 0xb0:		//OR B
-	{
-		return OR_n(registers.b);
-	}
-	case 0xb1:		//OR C
-	{
-		return OR_n(registers.c);
-	}
-	case 0xb2:		//OR D
-	{
-		return OR_n(registers.d);
-	}
-	case 0xb3:		//OR E
-	{
-		return OR_n(registers.e);
-	}
-	case 0xb4:		//OR H
-	{
-		return OR_n(registers.h);
-	}
-	case 0xb5:		//OR L
-	{
-		return OR_n(registers.l);
-	}
-	case 0xb6:		//OR (HL)
-	{
-		uint16_t hl = (registers.h << 8) | registers.l;
-		uint8_t n = _memory->read(hl);
-		OR_n(n);
-		return 2;
-	}
-	case 0xb7:		//OR A
-	{
-		return OR_n(registers.a);
-	}
-	case 0xb8:		//CP B
-	{
-		return CP_n(registers.b);
-	}
-	case 0xb9:		//CP C
-	{
-		return CP_n(registers.c);
-	}
-	case 0xba:		//CP D
-	{
-		return CP_n(registers.d);
-	}
-	case 0xbb:		//CP E
-	{
-		return CP_n(registers.e);
-	}
-	case 0xbc:		//CP H
-	{
-		return CP_n(registers.h);
-	}
-	case 0xbd:		//CP L
-	{
-		return CP_n(registers.l);
-	}
-	case 0xbe:		//CP (HL)
-	{
-		uint16_t hl = (registers.h << 8) | registers.l;
-		uint8_t n = _memory->read(hl);
+template <int r>
+int GameBoy::INC_r(uint16_t operand) {
+	uint8_t n = readReg8<r>(operand) + 1;
 
-		CP_n(n);
-		return 2;
-	}
-	case 0xbf:		//CP A
-	{
-		return CP_n(registers.a);
-	}
-	case 0xc0:		//RET NZ
-	{
-		if (!registers.flag.z) {
-			registers.pc = (_memory->read(registers.sp) | (_memory->read(registers.sp + 1) << 8));
-			registers.sp += 2;
-			return 5;
-		}
+	registers.flags.result = n;		//C is not affected
+	registers.flags.op = FLAGS_INC;
 
-		registers.pc += 1;
-		return 2;
-	}
-	case 0xc1:		//POP BC
-	{
-		registers.c = _memory->read(registers.sp);
-		registers.b = _memory->read(registers.sp + 1);
-		registers.sp += 2;
-		registers.pc += 1;
-		return 3;
-	}
-	case 0xc2:		//JP NZ d16
-	{
-		if (!registers.flag.z) {
-			uint16_t addr = (_memory->read(pc + 1) | (_memory->read(pc + 2) << 8));
-			registers.pc = addr;
-			return 4;
-		}
-		registers.pc += 3;
-		return 3;
-	}
-	case 0xc3:		//JP d16
-	{
-		uint16_t addr = (_memory->read(pc + 1) | (_memory->read(pc + 2) << 8));
-		registers.pc = addr;
-		return 4;
-	}
-	case 0xc4:		//CALL NZ
-	{
-		if (!registers.flag.z) {
-			uint16_t jump_addr = (_memory->read(pc + 1) | (_memory->read(pc + 2) << 8));
-
-			uint16_t ret_addr = pc + 3;
-			_memory->write(registers.sp - 1, (ret_addr >> 8) & 0xff);
-			_memory->write(registers.sp - 2, ret_addr & 0Xff);
-
-			registers.sp -= 2;
-			registers.pc = jump_addr;
-			return 6;
-		}
-		registers.pc += 3;
-		return 3;
-	}
-	case 0xc5:		//PUSH BC
-	{
-		_memory->write(registers.sp - 1, registers.b);
-		_memory->write(registers.sp - 2, registers.c);
-		registers.sp -= 2;
-		registers.pc += 1;
-		return 4;
-	}
-	
-	case 0xc6:		//ADD A, d8
-	{
-		uint8_t n = _memory->read(pc + 1);
-		ADD_n(n);
-		registers.pc += 1;
-		return 2;
-	}
-	case 0xc7:		//RST 0x0
-	{
-		uint16_t jump_addr = 0x0;
+	writeReg8<r>(n);
+	return (r == REG_HL_IND) ? 3 : 1;
+}
 
-		uint16_t ret_addr = pc + 1;
-		_memory->write(registers.sp - 1, (ret_addr >> 8) & 0xff);
-		_memory->write(registers.sp - 2, ret_addr & 0Xff);
+template <int r>
+int GameBoy::DEC_r(uint16_t operand) {
+	uint8_t n = readReg8<r>(operand) - 1;
 
-		registers.sp -= 2;
-		registers.pc = jump_addr;
-		return 4;
-	}
-	case 0xc8:		//RET Z
-	{
-		if (registers.flag.z) {
-			registers.pc = (_memory->read(registers.sp) | (_memory->read(registers.sp + 1) << 8));
-			registers.sp += 2;
-			return 5;
-		}
-		
-		registers.pc += 1;
-		return 2;
-	}
-	case 0xc9:		//RET
-	{
-		registers.pc = (_memory->read(registers.sp) | (_memory->read(registers.sp + 1) << 8));
-		registers.sp += 2;
-		return 4;
-	}
-	case 0xca:		//JP Z d16
-	{
-		if (registers.flag.z) {
-			uint16_t addr = (_memory->read(pc + 1) | (_memory->read(pc + 2) << 8));
-			registers.pc = addr;
-			return 4;
-		}
-		registers.pc += 3;
-		return 3;
-	}
-	case 0xcb:		//PREFIX
-	{
-		registers.pc += 1;
-		return prefixed_execute();
-	}
-	case 0xcc:		//CALL Z a16
-	{
-		if (registers.flag.z) {
-			uint16_t jump_addr = (_memory->read(pc + 1) | (_memory->read(pc + 2) << 8));
-
-			uint16_t ret_addr = pc + 3;
-			_memory->write(registers.sp - 1, (ret_addr >> 8) & 0xff);
-			_memory->write(registers.sp - 2, ret_addr & 0Xff);
-
-			registers.sp -= 2;
-			registers.pc = jump_addr;
-			return 6;
-		}
-		registers.pc += 3;
-		return 3;
-	}
-	case 0xcd:		//CALL 
-	{
-		uint16_t jump_addr = (_memory->read(pc + 1) | (_memory->read(pc + 2) << 8));
+	registers.flags.result = n;		//C is not affected
+	registers.flags.op = FLAGS_DEC;
 
-		uint16_t ret_addr = pc + 3;
-		_memory->write(registers.sp - 1, (ret_addr >> 8) & 0xff);
-		_memory->write(registers.sp - 2, ret_addr & 0Xff);
+	writeReg8<r>(n);
+	return (r == REG_HL_IND) ? 3 : 1;
+}
 
-		registers.sp -= 2;
-		registers.pc = jump_addr;
-		return 6;
-	}
-	case 0xce:		//ADC A, d8
-	{
-		uint8_t n = _memory->read(pc + 1);
-		ADC_A_n(n);
-		registers.pc += 1;
-		return 2;
-	}
-	case 0xcf:		//RST 0x8
-	{
-		uint16_t jump_addr = 0x8;
+template <int rr>
+int GameBoy::INC_rr(uint16_t operand) {
+	writeReg16<rr>(readReg16<rr>() + 1);
+	return 2;
+}
 
-		uint16_t ret_addr = pc + 1;
-		_memory->write(registers.sp - 1, (ret_addr >> 8) & 0xff);
-		_memory->write(registers.sp - 2, ret_addr & 0Xff);
+template <int rr>
+int GameBoy::DEC_rr(uint16_t operand) {
+	writeReg16<rr>(readReg16<rr>() - 1);
+	return 2;
+}
 
-		registers.sp -= 2;
-		registers.pc = jump_addr;
-		return 4;
-	}
-	case 0xd0:		//RET NC
-	{
-		if (!registers.flag.c) {
-			registers.pc = (_memory->read(registers.sp) | (_memory->read(registers.sp + 1) << 8));
-			registers.sp += 2;
-			return 5;
+template <int rr>
+int GameBoy::ADD_HL_rr(uint16_t operand) {
+	uint16_t hl = readReg16<REG_HL>();
+	uint16_t n = readReg16<rr>();
+	uint32_t sum = hl + n;
+
+	//Z is not affected
+	registers.flags.carry = (sum > 0xffff);
+	registers.flags.op = FLAGS_NH;
+	registers.flags.x = (((hl & 0xfff) + (n & 0xfff)) > 0xfff) ? FLAG_H : 0;
+
+	writeReg16<REG_HL>(sum & 0xffff);
+	return 2;
+}
+
+int GameBoy::ADD_SP_r8(uint16_t operand) {
+	int8_t n = operand & 0xff;
+	setFlags(1, ((registers.sp & 0xf) + (((uint8_t)n) & 0xf) > 0xf) ? FLAG_H : 0,
+		(registers.sp & 0xff) + ((uint8_t)n) > 0xff);
+	registers.sp += n;
+	return 4;
+}
+
+//8 bit ALU opcodes use one more cycle when the operand is (HL) or d8
+template <int r>
+int GameBoy::ADD_A_r(uint16_t operand) {
+	ADD_n(readReg8<r>(operand));
+	return (r == REG_HL_IND || r == REG_D8) ? 2 : 1;
+}
+
+template <int r>
+int GameBoy::ADC_A_r(uint16_t operand) {
+	ADC_A_n(readReg8<r>(operand));
+	return (r == REG_HL_IND || r == REG_D8) ? 2 : 1;
+}
+
+template <int r>
+int GameBoy::SUB_r(uint16_t operand) {
+	SUB_n(readReg8<r>(operand));
+	return (r == REG_HL_IND || r == REG_D8) ? 2 : 1;
+}
+
+template <int r>
+int GameBoy::SBC_A_r(uint16_t operand) {
+	SBC_A_n(readReg8<r>(operand));
+	return (r == REG_HL_IND || r == REG_D8) ? 2 : 1;
+}
+
+template <int r>
+int GameBoy::AND_r(uint16_t operand) {
+	AND_n(readReg8<r>(operand));
+	return (r == REG_HL_IND || r == REG_D8) ? 2 : 1;
+}
+
+template <int r>
+int GameBoy::XOR_r(uint16_t operand) {
+	XOR_n(readReg8<r>(operand));
+	return (r == REG_HL_IND || r == REG_D8) ? 2 : 1;
+}
+
+template <int r>
+int GameBoy::OR_r(uint16_t operand) {
+	OR_n(readReg8<r>(operand));
+	return (r == REG_HL_IND || r == REG_D8) ? 2 : 1;
+}
+
+template <int r>
+int GameBoy::CP_r(uint16_t operand) {
+	CP_n(readReg8<r>(operand));
+	return (r == REG_HL_IND || r == REG_D8) ? 2 : 1;
+}
+
+int GameBoy::DAA(uint16_t operand) {
+	uint8_t &a = registers.a;
+	uint8_t f = packFlags(registers.flags);
+	uint8_t cf = (f & FLAG_C) != 0;
+	uint8_t carry = cf;
+
+	if (f & FLAG_N) {		//subtraction in last math instruction
+		//4 lower nibbles greater than 9
+		if (((a & 0xf) > 9) || (f & FLAG_H)) {
+			carry |= (a < 6);
+			a -= 6;
 		}
-		
-		registers.pc += 1;
-		return 2;
-	}
-	case 0xd1:		//POP DE
-	{
-		registers.e = _memory->read(registers.sp);
-		registers.d = _memory->read(registers.sp + 1);
-		registers.sp += 2;
-		registers.pc += 1;
-		return 3;
-	}
-	case 0xd2:		//JP NC d16
-	{
-		if (!registers.flag.c) {
-			uint16_t addr = (_memory->read(pc + 1) | (_memory->read(pc + 2) << 8));
-			registers.pc = addr;
-			return 4;
+		//4 upper nibbles greater than 9
+		if ((a > 0x9f) || cf) {
+			a -= 0x60;
+			carry = 1;
 		}
-		registers.pc += 3;
-		return 3;
-	}
-	case 0xd3:		//INVALID OPCODE
-	{
-		fatal(FATAL_INVALID_OPCODE, __func__, "\nOpcode: 0xd3\nPC = " + std::to_string(registers.pc));
-		break;
-	}
-	case 0xd4:		//CALL NC a16
-	{
-		if (!registers.flag.c) {
-			uint16_t jump_addr = (_memory->read(pc + 1) | (_memory->read(pc + 2) << 8));
-
-			uint16_t ret_addr = pc + 3;
-			_memory->write(registers.sp - 1, (ret_addr >> 8) & 0xff);
-			_memory->write(registers.sp - 2, ret_addr & 0Xff);
-
-			registers.sp -= 2;
-			registers.pc = jump_addr;
-			return 6;
+		else {
+			carry = 0;
 		}
-		registers.pc += 3;
-		return 3;
 	}
-	case 0xd5:		//PUSH DE
-	{
-		_memory->write(registers.sp - 1, registers.d);
-		_memory->write(registers.sp - 2, registers.e);
-		registers.sp -= 2;
-		registers.pc += 1;
-		return 4;
+	else {
+		//4 lower nibbles greater than 9
+		if (((a & 0xf) > 9) || (f & FLAG_H)) {
+			carry |= (((uint16_t)a + 6) > 0xff);
+			a += 6;
+		}
+
+		//4 upper nibbles greater than 9
+		if ((a > 0x9f) || cf) {
+			carry = 1;
+			a += 0x60;
+		}
+		else {
+			carry = 0;
+		}
 	}
-	case 0xd6:		//SUB d8
-	{
-		uint8_t n = _memory->read(pc + 1);
-		registers.flag.h = ((registers.a & 0xf) < (n & 0xf));
-		registers.flag.c = (registers.a < n);
 
-		registers.a -= n;
-		registers.flag.z = (registers.a == 0);
-		registers.flag.n = 1;
+	setFlags(registers.a, f & FLAG_N, carry);		//N is not affected
+	return 1;
+}
+
+int GameBoy::CPL(uint16_t operand) {
+	registers.a = ~registers.a;
+	registers.flags.op = FLAGS_NH;		//Z and C are not affected
+	registers.flags.x = FLAG_N | FLAG_H;
+	return 1;
+}
+
+int GameBoy::SCF(uint16_t operand) {
+	registers.flags.carry = 1;
+	registers.flags.op = FLAGS_NH;		//Z is not affected
+	registers.flags.x = 0;
+	return 1;
+}
+
+int GameBoy::CCF(uint16_t operand) {
+	registers.flags.carry ^= 1;
+	registers.flags.op = FLAGS_NH;		//Z is not affected
+	registers.flags.x = 0;
+	return 1;
+}
 
-		registers.pc += 2;
-		return 2;
-	}
-	case 0xd7:		//RST 0x10
-	{
-		uint16_t jump_addr = 0x10;
+int GameBoy::RLCA(uint16_t operand) {
+	uint8_t bit7 = ((registers.a & 0x80) != 0);
+	registers.a <<= 1;
+	registers.a |= bit7;
+	setFlags(1, 0, bit7);
+	return 1;
+}
+
+int GameBoy::RRCA(uint16_t operand) {
+	uint8_t bit0 = (registers.a & 0x1);
+	registers.a >>= 1;
+	registers.a |= (bit0 << 7);
+	setFlags(1, 0, bit0);
+	return 1;
+}
 
-		uint16_t ret_addr = pc + 1;
-		_memory->write(registers.sp - 1, (ret_addr >> 8) & 0xff);
-		_memory->write(registers.sp - 2, ret_addr & 0Xff);
+int GameBoy::RLA(uint16_t operand) {
+	uint8_t bit0 = registers.flags.carry;
+	uint8_t carry = ((registers.a & 0x80) != 0);
+	registers.a <<= 1;
+	registers.a |= bit0;
+	setFlags(1, 0, carry);
+	return 1;
+}
 
-		registers.sp -= 2;
-		registers.pc = jump_addr;
-		return 4;
-	}
-	case 0xd8:		//RET C
-	{
-		if (registers.flag.c) {
-			registers.pc = (_memory->read(registers.sp) | (_memory->read(registers.sp + 1) << 8));
-			registers.sp += 2;
-			return 5;
-		}
+int GameBoy::RRA(uint16_t operand) {
+	uint8_t bit7 = registers.flags.carry;
+	uint8_t carry = (registers.a & 0x1);
+	registers.a >>= 1;
+	registers.a |= (bit7 << 7);
+	setFlags(1, 0, carry);
+	return 1;
+}
 
-		registers.pc += 1;
+template <int cc>
+int GameBoy::JR(uint16_t operand) {
+	if (!checkCondition<cc>())
 		return 2;
-	}
-	case 0xd9:		//RETI
-	{
-		registers.pc = (_memory->read(registers.sp) | (_memory->read(registers.sp + 1) << 8));
-		registers.sp += 2;
-		registers.IME = 1;
-		return 4;
-	}
-	case 0xda:		//JP C a16
-	{
-		if (registers.flag.c) {
-			uint16_t addr = (_memory->read(pc + 1) | (_memory->read(pc + 2) << 8));
-			registers.pc = addr;
-			return 4;
-		}
-		registers.pc += 3;
-		return 3;
-	}
-	case 0xdb:		//INVALID OPCODE
-	{
-		fatal(FATAL_INVALID_OPCODE, __func__, "\nOpcode: 0xdb\nPC = " + std::to_string(registers.pc));
-		break;
-	}
-	case 0xdc:		//CALL C a16
-	{
-		if (registers.flag.c) {
-			uint16_t jump_addr = (_memory->read(pc + 1) | (_memory->read(pc + 2) << 8));
-
-			uint16_t ret_addr = pc + 3;
-			_memory->write(registers.sp - 1, (ret_addr >> 8) & 0xff);
-			_memory->write(registers.sp - 2, ret_addr & 0Xff);
-
-			registers.sp -= 2;
-			registers.pc = jump_addr;
-			return 6;
-		}
-		registers.pc += 3;
+	registers.pc += (int8_t)(operand & 0xff);
+	return 3;
+}
+
+template <int cc>
+int GameBoy::JP(uint16_t operand) {
+	if (!checkCondition<cc>())
 		return 3;
-	}
-	case 0xdd:		//INVALID OPCODE
-	{
-		fatal(FATAL_INVALID_OPCODE, __func__, "\nOpcode: 0xdd\nPC = " + std::to_string(registers.pc));
-		break;
-	}
-	case 0xde:		//SBC A, d8
-	{
-		uint8_t n = _memory->read(pc + 1);
-		SBC_A_n(n);
-		registers.pc += 1;
-		return 2;
-	}
-	case 0xdf:		//RST 0x18
-	{
-		uint16_t jump_addr = 0x18;
+	registers.pc = operand;
+	return 4;
+}
 
-		uint16_t ret_addr = pc + 1;
-		_memory->write(registers.sp - 1, (ret_addr >> 8) & 0xff);
-		_memory->write(registers.sp - 2, ret_addr & 0Xff);
+int GameBoy::JP_HL(uint16_t operand) {
+	registers.pc = readReg16<REG_HL>();
+	return 1;
+}
 
-		registers.sp -= 2;
-		registers.pc = jump_addr;
-		return 4;
-	}
-	case 0xe0:		//LDH (n), A
-	{
-		uint16_t gb_addr = 0xff00 + _memory->read(pc + 1);
-		_memory->write(gb_addr, registers.a);
-		registers.pc += 2;
-		return 3;
-	}
-	case 0xe1:			//POP HL
-	{
-		registers.l = _memory->read(registers.sp);
-		registers.h = _memory->read(registers.sp + 1);
-		registers.sp += 2;
-		registers.pc += 1;
+template <int cc>
+int GameBoy::CALL(uint16_t operand) {
+	if (!checkCondition<cc>())
 		return 3;
-	}
-	case 0xe2:		//LD (C), A
-	{
-		uint16_t gb_addr = 0xff00 + registers.c;
-		_memory->write(gb_addr, registers.a);
-		registers.pc += 1;
-		return 2;
-	}
-	case 0xe3:		//INVALID OPCODE
-	{
-		fatal(FATAL_INVALID_OPCODE, __func__, "\nOpcode: 0xe3\nPC = " + std::to_string(registers.pc));
-		break;
-	}
-	case 0xe4:		//INVALID OPCODE
-	{
-		fatal(FATAL_INVALID_OPCODE, __func__, "\nOpcode: 0xe4\nPC = " + std::to_string(registers.pc));
-		break;
-	}
-	case 0xe5:		//PUSH HL
-	{
-		_memory->write(registers.sp - 1, registers.h);
-		_memory->write(registers.sp - 2, registers.l);
-		registers.sp -= 2;
-		registers.pc += 1;
-		return 4;
-	}
-	case 0xe6:		//AND d8
-	{
-		uint8_t n = _memory->read(pc + 1);
-		AND_n(n);
-		registers.pc += 1;
-		return 2;
-	}
-	case 0xe7:		//RST 0x20
-	{
-		uint16_t jump_addr = 0x20;
-
-		uint16_t ret_addr = pc + 1;
-		_memory->write(registers.sp - 1, (ret_addr >> 8) & 0xff);
-		_memory->write(registers.sp - 2, ret_addr & 0Xff);
+	push(registers.pc);		//return address
+	registers.pc = operand;
+	return 6;
+}
 
-		registers.sp -= 2;
-		registers.pc = jump_addr;
-		return 4;
-	}
-	case 0xe8:		//ADD SP, r8
-	{
-		char n = _memory->read(pc + 1);
-		registers.flag.h = ((registers.sp & 0xf) + (((uint8_t)n) & 0xf) > 0xf);
-		registers.flag.c = ((registers.sp & 0xff) + ((uint8_t)n) > 0xff);
-		registers.sp = (unsigned)((short)registers.sp + n);
-
-		registers.flag.z = 0;
-		registers.flag.n = 0;
-		registers.pc += 2;
-		return 4;
-	}
-	case 0xe9:		//JP HL
-	{
-		uint16_t hl = (registers.h << 8) | registers.l;
-		registers.pc = hl;
-		return 1;
-	}
-	case 0xea:		//LD (d16), A
-	{
-		uint16_t gb_addr = (_memory->read(pc + 1) | (_memory->read(pc + 2) << 8));
-		_memory->write(gb_addr, registers.a);
-		registers.pc += 3;
-		return 4;
-	}
-	case 0xeb:		//INVALID OPCODE
-	{
-		fatal(FATAL_INVALID_OPCODE, __func__, "\nOpcode: 0xeb\nPC = " + std::to_string(registers.pc));
-		break;
-	}
-	case 0xec:		//INVALID OPCODE
-	{
-		fatal(FATAL_INVALID_OPCODE, __func__, "\nOpcode: 0xec\nPC = " + std::to_string(registers.pc));
-		break;
-	}
-	case 0xed:		//INVALID OPCODE
-	{
-		fatal(FATAL_INVALID_OPCODE, __func__, "\nOpcode: 0xed\nPC = " + std::to_string(registers.pc));
-		break;
-	}
-	case 0xee:		//XOR d8
-	{
-		uint8_t n = _memory->read(pc + 1);
-		XOR_n(n);
-		registers.pc += 1;
+template <int cc>
+int GameBoy::RET_cc(uint16_t operand) {
+	if (!checkCondition<cc>())
 		return 2;
-	}
-	case 0xef:		//RST 28H
-	{
-		uint16_t jump_addr = 0x28;
+	registers.pc = pop();
+	return 5;
+}
 
-		uint16_t ret_addr = pc + 1;
-		_memory->write(registers.sp - 1, (ret_addr >> 8) & 0xff);
-		_memory->write(registers.sp - 2, ret_addr & 0Xff);
+int GameBoy::RET(uint16_t operand) {
+	registers.pc = pop();
+	return 4;
+}
 
-		registers.sp -= 2;
-		registers.pc = jump_addr;
-		return 4;
-	}
-	case 0xf0:		//LDH A, d8
-	{
-		uint16_t gb_addr = 0xff00 + _memory->read(pc + 1);
-		registers.a = _memory->read(gb_addr);
-		registers.pc += 2;
-		return 3;
-	}
-	case 0xf1:		//POP AF
-	{
-		*((uint8_t*)&registers.flag) = _memory->read(registers.sp );
-		registers.a = _memory->read(registers.sp + 1);
+int GameBoy::RETI(uint16_t operand) {
+	registers.pc = pop();
+	registers.IME = 1;
+	return 4;
+}
 
-		registers.sp += 2;
-		registers.pc += 1;
-		return 3;
-	}
-	case 0xf2:		//LD A,(C)
-	{
-		uint16_t gb_addr = 0xff00 + registers.c;
-		registers.a = _memory->read(gb_addr);
-		registers.pc += 1;
-		return 2;
-	}
-	case 0xf3:		//DI
-	{
-		registers.IME_U = 0;
-		registers.IME_CC = 2;
-		registers.pc += 1;
-		return 1;
-	}
-	case 0xf4:		//INVALID OPCODE
-	{
-		fatal(FATAL_INVALID_OPCODE, __func__, "\nOpcode: 0xf4\nPC = " + std::to_string(registers.pc));
-		break;
-	}
-	case 0xf5:		//PUSH AF
-	{
-		uint8_t flag = *((uint8_t*)&registers.flag);
-		_memory->write(registers.sp - 1, registers.a);
-		_memory->write(registers.sp - 2, flag);
-		registers.sp -= 2;
-		registers.pc += 1;
-		return 4;
-	}
-	case 0xf6:		//OR d8
-	{
-		uint8_t n = _memory->read(pc + 1);
-		OR_n(n);
-		registers.pc += 1;
-		return 2;
-	}
-	case 0xf7:		//RST 0x30
-	{
-		uint16_t jump_addr = 0x30;
+template <uint16_t addr>
+int GameBoy::RST(uint16_t operand) {
+	push(registers.pc);		//return address
+	registers.pc = addr;
+	return 4;
+}
 
-		uint16_t ret_addr = pc + 1;
-		_memory->write(registers.sp - 1, (ret_addr >> 8) & 0xff);
-		_memory->write(registers.sp - 2, ret_addr & 0Xff);
+//prefixed opcodes on (HL) take 4 cycles, except BIT that takes 3
+template <int r>
+int GameBoy::RLC_r(uint16_t operand) {
+	uint8_t n = readReg8<r>(operand);
+	RLC_n(n);
+	writeReg8<r>(n);
+	return (r == REG_HL_IND) ? 4 : 2;
+}
 
-		registers.sp -= 2;
-		registers.pc = jump_addr;
-		return 4;
-	}
-	case 0xf8:		//LD HL, SP + r8
-	{
-		uint8_t n = _memory->read(pc + 1);
-		uint16_t hl = registers.sp + n;
-
-		registers.flag.z = 0;
-		registers.flag.n = 0;
-		registers.flag.h = (((registers.sp & 0xf) + (n & 0xf)) > 0xf);
-		registers.flag.c = (((registers.sp & 0xff) + n) > 0xff);
-
-		registers.h = (hl >> 8) & 0xff;
-		registers.l = hl & 0xff;
-		registers.pc += 2;
-		return 3;
-	}
-	case 0xf9:		//LD SP, HL
-	{
-		uint16_t hl = (registers.h << 8) | registers.l;
-		registers.sp = hl;
-		registers.pc += 1;
-		return 2;
-	}
-	case 0xfa:		//LD A, (d16)
-	{
-		uint16_t gb_addr = (_memory->read(pc + 1) | (_memory->read(pc + 2) << 8));
-		registers.a = _memory->read(gb_addr);
- 		registers.pc += 3;
-		return 4;
-	}
-	case 0xfb:		//EI
-	{
-		registers.IME_U = 1;
-		registers.IME_CC = 2;
-		registers.pc += 1;
-		return 1;
-	}
-	case 0xfc:				//INVALID OPCODE
-	{
-		fatal(FATAL_INVALID_OPCODE, __func__, "\nOpcode: 0xfc\nPC = " + std::to_string(registers.pc));
-		break;
-	}
-	case 0xfd:				//INVALID OPCODE
-	{
-		fatal(FATAL_INVALID_OPCODE, __func__, "\nOpcode: 0xfd\nPC = " + std::to_string(registers.pc));
-		break;
-	}
-	case 0xfe:		//CP, d8
-	{
-		uint8_t d = _memory->read(pc + 1);
-		registers.flag.z = (registers.a == d);
-		registers.flag.n = 1;
-		registers.flag.h = ((registers.a & 0xf) < (d & 0xf));
-		registers.flag.c = (registers.a < d);
-		registers.pc += 2;
-		return 2;
-	}
-	case 0xff:		//RST 0x38
-	{
-		uint16_t jump_addr = 0x38;
+template <int r>
+int GameBoy::RRC_r(uint16_t operand) {
+	uint8_t n = readReg8<r>(operand);
+	RRC_n(n);
+	writeReg8<r>(n);
+	return (r == REG_HL_IND) ? 4 : 2;
+}
 
-		uint16_t ret_addr = pc + 1;
-		_memory->write(registers.sp - 1, (ret_addr >> 8) & 0xff);
-		_memory->write(registers.sp - 2, ret_addr & 0Xff);
+template <int r>
+int GameBoy::RL_r(uint16_t operand) {
+	uint8_t n = readReg8<r>(operand);
+	RL_n(n);
+	writeReg8<r>(n);
+	return (r == REG_HL_IND) ? 4 : 2;
+}
 
-		registers.sp -= 2;
-		registers.pc = jump_addr;
-		return 4;
-	}
-	default:
- 		std::cout << "\nInstruction not implemented: 0x" << std::hex << (int)opcode;
-		fatal(FATAL_INSTRUCTION_NOT_IMPLEMENTED, __func__);
-	}
+template <int r>
+int GameBoy::RR_r(uint16_t operand) {
+	uint8_t n = readReg8<r>(operand);
+	RR_n(n);
+	writeReg8<r>(n);
+	return (r == REG_HL_IND) ? 4 : 2;
+}
 
-	return 0;
+template <int r>
+int GameBoy::SLA_r(uint16_t operand) {
+	uint8_t n = readReg8<r>(operand);
+	SLA_n(n);
+	writeReg8<r>(n);
+	return (r == REG_HL_IND) ? 4 : 2;
 }
 
+template <int r>
+int GameBoy::SRA_r(uint16_t operand) {
+	uint8_t n = readReg8<r>(operand);
+	SRA_n(n);
+	writeReg8<r>(n);
+	return (r == REG_HL_IND) ? 4 : 2;
+}
 
-int GameBoy::prefixed_execute() {
-	uint16_t pc = registers.pc;
-	uint8_t opcode = _memory->read(pc);
+template <int r>
+int GameBoy::SWAP_r(uint16_t operand) {
+	uint8_t n = readReg8<r>(operand);
+	SWAP_n(n);
+	writeReg8<r>(n);
+	return (r == REG_HL_IND) ? 4 : 2;
+}
 
-	switch (opcode) {
-	case 0x00:		//RLC B
-	{
-		return RLC_n(registers.b);
-	}
-	case 0x01:		//RLC C
-	{
-		return RLC_n(registers.c);
-	}
-	case 0x02:		//RLC D
-	{
-		return RLC_n(registers.d);
-	}
-	case 0x03:		//RLC E
-	{
-		return RLC_n(registers.e);
-	}
-	case 0x04:		//RLC H
-	{
-		return RLC_n(registers.h);
-	}
-	case 0x05:		//RLC L
-	{
-		return RLC_n(registers.l);
-	}
-	case 0x06:		//RLC (HL)
-	{
-		uint16_t hl = (registers.h << 8) | registers.l;
-		uint8_t n = _memory->read(hl);
-		RLC_n(n);
-		_memory->write(hl, n);
-		return 4;
-	}
-	case 0x07:		//RLC A
-	{
-		return RLC_n(registers.a);
-	}
-	case 0x08:		//RRC B
-	{
-		return RRC_n(registers.b);
-	}
-	case 0x09:		//RRC C
-	{
-		return RRC_n(registers.c);
-	}
-	case 0x0a:		//RRC D
-	{
-		return RRC_n(registers.d);
-	}
-	case 0x0b:		//RRC E
-	{
-		return RRC_n(registers.e);
-	}
-	case 0x0c:		//RRC H
-	{
-		return RRC_n(registers.h);
-	}
-	case 0x0d:		//RRC L
-	{
-		return RRC_n(registers.l);
-	}
-	case 0x0e:		//RRC (HL)
-	{
-		uint16_t hl = (registers.h << 8) | registers.l;
-		uint8_t n = _memory->read(hl);
-		RRC_n(n);
-		_memory->write(hl, n);
-		return 4;
-	}
-	case 0xf:		//RRC A
-	{
-		return RRC_n(registers.a);
-	}
-	case 0x10:		//RL B
-	{
-		return RL_n(registers.b);
-	}
-	case 0x11:		//RL C
-	{
-		return RL_n(registers.c);
-	}
-	case 0x12:		//RL D
-	{
-		return RL_n(registers.d);
-	}
-	case 0x13:		//RL E
-	{
-		return RL_n(registers.e);
-	}
-	case 0x14:		//RL H
-	{
-		return RL_n(registers.h);
-	}
-	case 0x15:		//RL L
-	{
-		return RL_n(registers.l);
-	}
-	case 0x16:		//RL (HL)
-	{
-		uint16_t hl = (registers.h << 8) | registers.l;
-		uint8_t n = _memory->read(hl);
-		RL_n(n);
-		_memory->write(hl, n);
-		return 4;
-	}
-	case 0x17:		//RL A
-	{
-		return RL_n(registers.a);
-	}
-	case 0x18:		//RR B
-	{
-		return RR_n(registers.b);
-	}
-	case 0x19:		//RR C
-	{
-		return RR_n(registers.c);
-	}
-	case 0x1a:		//RR D
-	{
-		return RR_n(registers.d);
-	}
-	case 0x1b:		//RR E
-	{
-		return RR_n(registers.e);
-	}
-	case 0x1c:		//RR H
-	{
-		return RR_n(registers.h);
-	}
-	case 0x1d:		//RR L
-	{
-		return RR_n(registers.l);
-	}
-	case 0x1e:		//RR (HL)
-	{
-		uint16_t hl = (registers.h << 8) | registers.l;
-		uint8_t n = _memory->read(hl);
-		RR_n(n);
-		_memory->write(hl, n);
-		return 4;
-	}
-	case 0x1f:		//RR A
-	{
-		return RR_n(registers.a);
-	}
-	
-	case 0x20:		//SLA B
-	{
-		return SLA_n(registers.b);
-	}
-	case 0x21:		//SLA C
-	{
-		return SLA_n(registers.c);
-	}
-	case 0x22:		//SLA D
-	{
-		return SLA_n(registers.d);
-	}
-	case 0x23:		//SLA E
-	{
-		return SLA_n(registers.e);
-	}
-	case 0x24:		//SLA H
-	{
-		return SLA_n(registers.h);
-	}
-	case 0x25:		//SLA L
-	{
-		return SLA_n(registers.l);
-	}
-	case 0x26:		//SLA (HL)
-	{
-		uint16_t hl = (registers.h << 8) | registers.l;
-		uint8_t n = _memory->read(hl);
-		SLA_n(n);
-		_memory->write(hl, n);
-		return 4;
-	}
-	case 0x27:		//SLA A
-	{
-		return SLA_n(registers.a);
-	}
-	case 0x28:		//SRA B
-	{
-		return SRA_n(registers.b);
-	}
-	case 0x29:		//SRA C
-	{
-		return SRA_n(registers.c);
-	}
-	case 0x2a:		//SRA D
-	{
-		return SRA_n(registers.d);
-	}
-	case 0x2b:		//SRA E
-	{
-		return SRA_n(registers.e);
-	}
-	case 0x2c:		//SRA H
-	{
-		return SRA_n(registers.h);
-	}
-	case 0x2d:		//SRA L
-	{
-		return SRA_n(registers.l);
-	}
-	case 0x2e:		//SRA (HL)
-	{
-		uint16_t hl = (registers.h << 8) | registers.l;
-		uint8_t n = _memory->read(hl);
-		SRA_n(n);
-		_memory->write(hl, n);
-		return 4;
-	}
-	case 0x2f:		//SRA A
-	{
-		return SRA_n(registers.a);
-	}
-	case 0x30:		//SWAP B
-	{
-		return SWAP_n(registers.b);
-	}
-	case 0x31:		//SWAP C
-	{
-		return SWAP_n(registers.c);
-	}
-	case 0x32:		//SWAP D
-	{
-		return SWAP_n(registers.d);
-	}
-	case 0x33:		//SWAP E
-	{
-		return SWAP_n(registers.e);
-	}
-	case 0x34:		//SWAP H
-	{
-		return SWAP_n(registers.h);
-	}
-	case 0x35:		//SWAP L
-	{
-		return SWAP_n(registers.l);
-	}
-	case 0x36:		//SWAP (HL)
-	{
-		uint16_t hl = (registers.h << 8) | registers.l;
-		uint8_t n = _memory->read(hl);
-		SWAP_n(n);
-		_memory->write(hl, n);
-		return 4;
-	}
-	case 0x37:		//SWAP A
-	{
-		return SWAP_n(registers.a);
-	}
-	case 0x38:		//SRL B
-	{
-		return SRL_n(registers.b);
-	}
-	case 0x39:		//SRL C
-	{
-		return SRL_n(registers.c);
-	}
-	case 0x3a:		//SRL D
-	{
-		return SRL_n(registers.d);
-	}
-	case 0x3b:		//SRL E
-	{
-		return SRL_n(registers.e);
-	}
-	case 0x3c:		//SRL H
-	{
-		return SRL_n(registers.h);
-	}
-	case 0x3d:		//SRL L
-	{
-		return SRL_n(registers.l);
-	}
-	case 0x3e:		//SRL (HL)
-	{
-		uint16_t hl = (registers.h << 8) | registers.l;
-		uint8_t n = _memory->read(hl);
-		SRL_n(n);
-		_memory->write(hl, n);
-		return 4;
-	}
-	case 0x3f:		//SRL A
-	{
-		return SRL_n(registers.a);
-	}
+template <int r>
+int GameBoy::SRL_r(uint16_t operand) {
+	uint8_t n = readReg8<r>(operand);
+	SRL_n(n);
+	writeReg8<r>(n);
+	return (r == REG_HL_IND) ? 4 : 2;
+}
 
-	//BIT b, B	
-	case 0x40:case 0x48:case 0x50:case 0x58:case 0x60:case 0x68:case 0x70:case 0x78:
-	{
-		uint8_t bit = (opcode - 0x40) / 8;
-		registers.flag.z = ((registers.b & (0x1 << bit)) == 0);
-		registers.flag.n = 0;
-		registers.flag.h = 1;
-		registers.pc += 1;
-		return 2;
-	}
-	//BIT b, C
-	case 0x41:case 0x49:case 0x51:case 0x59:case 0x61:case 0x69:case 0x71:case 0x79:
-	{
-		uint8_t bit = (opcode - 0x41) / 8;
-		registers.flag.z = ((registers.c & (0x1 << bit)) == 0);
-		registers.flag.n = 0;
-		registers.flag.h = 1;
-		registers.pc += 1;
-		return 2;
-	}
-	//BIT b, D
-	case 0x42:case 0x4a:case 0x52:case 0x5a:case 0x62:case 0x6a:case 0x72:case 0x7a:
-	{
-		uint8_t bit = (opcode - 0x42) / 8;
-		registers.flag.z = ((registers.d & (0x1 << bit)) == 0);
-		registers.flag.n = 0;
-		registers.flag.h = 1;
-		registers.pc += 1;
-		return 2;
-	}
-	//BIT b, E
-	case 0x43:case 0x4b:case 0x53:case 0x5b:case 0x63:case 0x6b:case 0x73:case 0x7b:
-	{
-		uint8_t bit = (opcode - 0x43) / 8;
-		registers.flag.z = ((registers.e & (0x1 << bit)) == 0);
-		registers.flag.n = 0;
-		registers.flag.h = 1;
-		registers.pc += 1;
-		return 2;
-	}
-	//BIT b, H
-	case 0x44:case 0x4c:case 0x54:case 0x5c:case 0x64:case 0x6c:case 0x74:case 0x7c:
-	{
-		uint8_t bit = (opcode - 0x44) / 8;
-		registers.flag.z = ((registers.h & (0x1 << bit)) == 0);
-		registers.flag.n = 0;
-		registers.flag.h = 1;
-		registers.pc += 1;
-		return 2;
-	}
-	//BIT b, L
-	case 0x45:case 0x4d:case 0x55:case 0x5d:case 0x65:case 0x6d:case 0x75:case 0x7d:
-	{
-		uint8_t bit = (opcode - 0x45) / 8;
-		registers.flag.z = ((registers.l & (0x1 << bit)) == 0);
-		registers.flag.n = 0;
-		registers.flag.h = 1;
-		registers.pc += 1;
-		return 2;
-	}
-	//BIT b, (HL)
-	case 0x46:case 0x4e:case 0x56:case 0x5e:case 0x66:case 0x6e:case 0x76:case 0x7e:
-	{
-		uint8_t bit = (opcode - 0x46) / 8;
-		uint16_t hl = (registers.h << 8) | registers.l;
-		uint8_t n = _memory->read(hl);
-		registers.flag.z = ((n & (0x1 << bit)) == 0);
-		registers.flag.n = 0;
-		registers.flag.h = 1;
-		registers.pc += 1;
-		return 3;
-	}
-	//BIT b, A
-	case 0x47:case 0x4f:case 0x57:case 0x5f:case 0x67:case 0x6f:case 0x77:case 0x7f:
-	{
-		uint8_t bit = (opcode - 0x47) / 8;
-		registers.flag.z = ((registers.a & (0x1 << bit)) == 0);
-		registers.flag.n = 0;
-		registers.flag.h = 1;
-		registers.pc += 1;
-		return 2;
-	}
-	//RES b, B
-	case 0x80:case 0x88:case 0x90:case 0x98:case 0xa0:case 0xa8:case 0xb0:case 0xb8:
-	{
-		uint8_t bit = (opcode - 0x80) / 8;
-		registers.b &= ~(0x1 << bit);
-		registers.pc += 1;
-		return 2;
-	}
-	//RES b, C
-	case 0x81:case 0x89:case 0x91:case 0x99:case 0xa1:case 0xa9:case 0xb1:case 0xb9:
-	{
-		uint8_t bit = (opcode - 0x81) / 8;
-		registers.c &= ~(0x1 << bit);
-		registers.pc += 1;
-		return 2;
-	}
-	//RES b, D
-	case 0x82:case 0x8a:case 0x92:case 0x9a:case 0xa2:case 0xaa:case 0xb2:case 0xba:
-	{
-		uint8_t bit = (opcode - 0x82) / 8;
-		registers.d &= ~(0x1 << bit);
-		registers.pc += 1;
-		return 2;
-	}
-	//RES b, E
-	case 0x83:case 0x8b:case 0x93:case 0x9b:case 0xa3:case 0xab:case 0xb3:case 0xbb:
-	{
-		uint8_t bit = (opcode - 0x83) / 8;
-		registers.e &= ~(0x1 << bit);
-		registers.pc += 1;
-		return 2;
-	}
-	//RES b, H
-	case 0x84:case 0x8c:case 0x94:case 0x9c:case 0xa4:case 0xac:case 0xb4:case 0xbc:
-	{
-		uint8_t bit = (opcode - 0x84) / 8;
-		registers.h &= ~(0x1 << bit);
-		registers.pc += 1;
-		return 2;
-	}
-	//RES b, L
-	case 0x85:case 0x8d:case 0x95:case 0x9d:case 0xa5:case 0xad:case 0xb5:case 0xbd:
-	{
-		uint8_t bit = (opcode - 0x85) / 8;
-		registers.l &= ~(0x1 << bit);
-		registers.pc += 1;
-		return 2;
-	}
-	//RES b, (HL)
-	case 0x86:case 0x8e:case 0x96:case 0x9e:case 0xa6:case 0xae:case 0xb6:case 0xbe:
-	{
-		uint8_t bit = (opcode - 0x86) / 8;
-		uint16_t hl = (registers.h << 8) | registers.l;
-		uint8_t n = _memory->read(hl);
-		n &= ~(0x1 << bit);
-		_memory->write(hl, n);
-		registers.pc += 1;
-		return 4;
-	}
-	//RES b, A
-	case 0x87:case 0x8f:case 0x97:case 0x9f:case 0xa7:case 0xaf:case 0xb7:case 0xbf:
-	{
-		uint8_t bit = (opcode - 0x87) / 8;
-		registers.a &= ~(0x1 << bit);
-		registers.pc += 1;
-		return 2;
-	}
-	//SET b, B
-	case 0xc0:case 0xc8:case 0xd0:case 0xd8:case 0xe0:case 0xe8:case 0xf0:case 0xf8:
-	{
-		uint8_t bit = (opcode - 0xc0) / 8;
-		registers.b |= (0x1 << bit);
-		registers.pc += 1;
-		return 2;
-	}
-	//SET b, C
-	case 0xc1:case 0xc9:case 0xd1:case 0xd9:case 0xe1:case 0xe9:case 0xf1:case 0xf9:
-	{
-		uint8_t bit = (opcode - 0xc1) / 8;
-		registers.c |= (0x1 << bit);
-		registers.pc += 1;
-		return 2;
-	}
-	//SET b, D
-	case 0xc2:case 0xca:case 0xd2:case 0xda:case 0xe2:case 0xea:case 0xf2:case 0xfa:
-	{
-		uint8_t bit = (opcode - 0xc2) / 8;
-		registers.d |= (0x1 << bit);
-		registers.pc += 1;
-		return 2;
-	}
-	//SET b, E
-	case 0xc3:case 0xcb:case 0xd3:case 0xdb:case 0xe3:case 0xeb:case 0xf3:case 0xfb:
-	{
-		uint8_t bit = (opcode - 0xc3) / 8;
-		registers.e |= (0x1 << bit);
-		registers.pc += 1;
-		return 2;
-	}
-	//SET b, H
-	case 0xc4:case 0xcc:case 0xd4:case 0xdc:case 0xe4:case 0xec:case 0xf4:case 0xfc:
-	{
-		uint8_t bit = (opcode - 0xc4) / 8;
-		registers.h |= (0x1 << bit);
-		registers.pc += 1;
-		return 2;
-	}
-	//SET b, L
-	case 0xc5:case 0xcd:case 0xd5:case 0xdd:case 0xe5:case 0xed:case 0xf5:case 0xfd:
-	{
-		uint8_t bit = (opcode - 0xc5) / 8;
-		registers.l |= (0x1 << bit);
-		registers.pc += 1;
-		return 2;
-	}
-	//SET b, (HL)
-	case 0xc6:case 0xce:case 0xd6:case 0xde:case 0xe6:case 0xee:case 0xf6:case 0xfe:
-	{
-		uint8_t bit = (opcode - 0xc6) / 8;
-		uint16_t hl = (registers.h << 8) | registers.l;
-		uint8_t d = _memory->read(hl);
-		d |= (0x1 << bit);
-		_memory->write(hl, d);
-		registers.pc += 1;
-		return 4;
-	}
-	//SET b, A
-	case 0xc7:case 0xcf:case 0xd7:case 0xdf:case 0xe7:case 0xef:case 0xf7:case 0xff:
-	{
-		uint8_t bit = (opcode - 0xc7) / 8;
-		registers.a |= (0x1 << bit);
-		registers.pc += 1;
-		return 2;
-	}
-	default:
-		std::cout << "\nInstruction not implemented (0xCB xx): 0x" << std::hex << (int)opcode;
-		fatal(FATAL_INSTRUCTION_NOT_IMPLEMENTED, __func__);
-	}
+template <int b, int r>
+int GameBoy::BIT_b_r(uint16_t operand) {
+	registers.flags.result = readReg8<r>(operand) & (0x1 << b);		//C is not affected
+	registers.flags.op = FLAGS_NH;
+	registers.flags.x = FLAG_H;
+	return (r == REG_HL_IND) ? 3 : 2;
+}
 
-	return 0;
+template <int b, int r>
+int GameBoy::RES_b_r(uint16_t operand) {
+	writeReg8<r>(readReg8<r>(operand) & ~(0x1 << b));
+	return (r == REG_HL_IND) ? 4 : 2;
+}
+
+template <int b, int r>
+int GameBoy::SET_b_r(uint16_t operand) {
+	writeReg8<r>(readReg8<r>(operand) | (0x1 << b));
+	return (r == REG_HL_IND) ? 4 : 2;
 }
 
-int GameBoy::SWAP_n(uint8_t& reg) {
+const opcode_info GameBoy::opcodeTable[256] = {
+	{ &GameBoy::NOP, 1, 1, "NOP" },		//0x00
+	{ &GameBoy::LD_rr_d16<REG_BC>, 3, 3, "LD BC, d16" },		//0x01
+	{ &GameBoy::LD_pRR_A<REG_BC>, 1, 2, "LD (BC), A" },		//0x02
+	{ &GameBoy::INC_rr<REG_BC>, 1, 2, "INC BC" },		//0x03
+	{ &GameBoy::INC_r<REG_B>, 1, 1, "INC B" },		//0x04
+	{ &GameBoy::DEC_r<REG_B>, 1, 1, "DEC B" },		//0x05
+	{ &GameBoy::LD_r_d8<REG_B>, 2, 2, "LD B, d8" },		//0x06
+	{ &GameBoy::RLCA, 1, 1, "RLCA" },		//0x07
+	{ &GameBoy::LD_a16_SP, 3, 5, "LD (a16), SP" },		//0x08
+	{ &GameBoy::ADD_HL_rr<REG_BC>, 1, 2, "ADD HL, BC" },		//0x09
+	{ &GameBoy::LD_A_pRR<REG_BC>, 1, 2, "LD A, (BC)" },		//0x0a
+	{ &GameBoy::DEC_rr<REG_BC>, 1, 2, "DEC BC" },		//0x0b
+	{ &GameBoy::INC_r<REG_C>, 1, 1, "INC C" },		//0x0c
+	{ &GameBoy::DEC_r<REG_C>, 1, 1, "DEC C" },		//0x0d
+	{ &GameBoy::LD_r_d8<REG_C>, 2, 2, "LD C, d8" },		//0x0e
+	{ &GameBoy::RRCA, 1, 1, "RRCA" },		//0x0f
+	{ &GameBoy::STOP, 2, 1, "STOP d8" },		//0x10
+	{ &GameBoy::LD_rr_d16<REG_DE>, 3, 3, "LD DE, d16" },		//0x11
+	{ &GameBoy::LD_pRR_A<REG_DE>, 1, 2, "LD (DE), A" },		//0x12
+	{ &GameBoy::INC_rr<REG_DE>, 1, 2, "INC DE" },		//0x13
+	{ &GameBoy::INC_r<REG_D>, 1, 1, "INC D" },		//0x14
+	{ &GameBoy::DEC_r<REG_D>, 1, 1, "DEC D" },		//0x15
+	{ &GameBoy::LD_r_d8<REG_D>, 2, 2, "LD D, d8" },		//0x16
+	{ &GameBoy::RLA, 1, 1, "RLA" },		//0x17
+	{ &GameBoy::JR<COND_ALWAYS>, 2, 3, "JR r8" },		//0x18
+	{ &GameBoy::ADD_HL_rr<REG_DE>, 1, 2, "ADD HL, DE" },		//0x19
+	{ &GameBoy::LD_A_pRR<REG_DE>, 1, 2, "LD A, (DE)" },		//0x1a
+	{ &GameBoy::DEC_rr<REG_DE>, 1, 2, "DEC DE" },		//0x1b
+	{ &GameBoy::INC_r<REG_E>, 1, 1, "INC E" },		//0x1c
+	{ &GameBoy::DEC_r<REG_E>, 1, 1, "DEC E" },		//0x1d
+	{ &GameBoy::LD_r_d8<REG_E>, 2, 2, "LD E, d8" },		//0x1e
+	{ &GameBoy::RRA, 1, 1, "RRA" },		//0x1f
+	{ &GameBoy::JR<COND_NZ>, 2, 2, "JR NZ, r8" },		//0x20
+	{ &GameBoy::LD_rr_d16<REG_HL>, 3, 3, "LD HL, d16" },		//0x21
+	{ &GameBoy::LD_HLI_A, 1, 2, "LD (HL+), A" },		//0x22
+	{ &GameBoy::INC_rr<REG_HL>, 1, 2, "INC HL" },		//0x23
+	{ &GameBoy::INC_r<REG_H>, 1, 1, "INC H" },		//0x24
+	{ &GameBoy::DEC_r<REG_H>, 1, 1, "DEC H" },		//0x25
+	{ &GameBoy::LD_r_d8<REG_H>, 2, 2, "LD H, d8" },		//0x26
+	{ &GameBoy::DAA, 1, 1, "DAA" },		//0x27
+	{ &GameBoy::JR<COND_Z>, 2, 2, "JR Z, r8" },		//0x28
+	{ &GameBoy::ADD_HL_rr<REG_HL>, 1, 2, "ADD HL, HL" },		//0x29
+	{ &GameBoy::LD_A_HLI, 1, 2, "LD A, (HL+)" },		//0x2a
+	{ &GameBoy::DEC_rr<REG_HL>, 1, 2, "DEC HL" },		//0x2b
+	{ &GameBoy::INC_r<REG_L>, 1, 1, "INC L" },		//0x2c
+	{ &GameBoy::DEC_r<REG_L>, 1, 1, "DEC L" },		//0x2d
+	{ &GameBoy::LD_r_d8<REG_L>, 2, 2, "LD L, d8" },		//0x2e
+	{ &GameBoy::CPL, 1, 1, "CPL" },		//0x2f
+	{ &GameBoy::JR<COND_NC>, 2, 2, "JR NC, r8" },		//0x30
+	{ &GameBoy::LD_rr_d16<REG_SP>, 3, 3, "LD SP, d16" },		//0x31
+	{ &GameBoy::LD_HLD_A, 1, 2, "LD (HL-), A" },		//0x32
+	{ &GameBoy::INC_rr<REG_SP>, 1, 2, "INC SP" },		//0x33
+	{ &GameBoy::INC_r<REG_HL_IND>, 1, 3, "INC (HL)" },		//0x34
+	{ &GameBoy::DEC_r<REG_HL_IND>, 1, 3, "DEC (HL)" },		//0x35
+	{ &GameBoy::LD_r_d8<REG_HL_IND>, 2, 3, "LD (HL), d8" },		//0x36
+	{ &GameBoy::SCF, 1, 1, "SCF" },		//0x37
+	{ &GameBoy::JR<COND_C>, 2, 2, "JR C, r8" },		//0x38
+	{ &GameBoy::ADD_HL_rr<REG_SP>, 1, 2, "ADD HL, SP" },		//0x39
+	{ &GameBoy::LD_A_HLD, 1, 2, "LD A, (HL-)" },		//0x3a
+	{ &GameBoy::DEC_rr<REG_SP>, 1, 2, "DEC SP" },		//0x3b
+	{ &GameBoy::INC_r<REG_A>, 1, 1, "INC A" },		//0x3c
+	{ &GameBoy::DEC_r<REG_A>, 1, 1, "DEC A" },		//0x3d
+	{ &GameBoy::LD_r_d8<REG_A>, 2, 2, "LD A, d8" },		//0x3e
+	{ &GameBoy::CCF, 1, 1, "CCF" },		//0x3f
+	{ &GameBoy::LD_r_r<REG_B, REG_B>, 1, 1, "LD B, B" },		//0x40
+	{ &GameBoy::LD_r_r<REG_B, REG_C>, 1, 1, "LD B, C" },		//0x41
+	{ &GameBoy::LD_r_r<REG_B, REG_D>, 1, 1, "LD B, D" },		//0x42
+	{ &GameBoy::LD_r_r<REG_B, REG_E>, 1, 1, "LD B, E" },		//0x43
+	{ &GameBoy::LD_r_r<REG_B, REG_H>, 1, 1, "LD B, H" },		//0x44
+	{ &GameBoy::LD_r_r<REG_B, REG_L>, 1, 1, "LD B, L" },		//0x45
+	{ &GameBoy::LD_r_r<REG_B, REG_HL_IND>, 1, 2, "LD B, (HL)" },		//0x46
+	{ &GameBoy::LD_r_r<REG_B, REG_A>, 1, 1, "LD B, A" },		//0x47
+	{ &GameBoy::LD_r_r<REG_C, REG_B>, 1, 1, "LD C, B" },		//0x48
+	{ &GameBoy::LD_r_r<REG_C, REG_C>, 1, 1, "LD C, C" },		//0x49
+	{ &GameBoy::LD_r_r<REG_C, REG_D>, 1, 1, "LD C, D" },		//0x4a
+	{ &GameBoy::LD_r_r<REG_C, REG_E>, 1, 1, "LD C, E" },		//0x4b
+	{ &GameBoy::LD_r_r<REG_C, REG_H>, 1, 1, "LD C, H" },		//0x4c
+	{ &GameBoy::LD_r_r<REG_C, REG_L>, 1, 1, "LD C, L" },		//0x4d
+	{ &GameBoy::LD_r_r<REG_C, REG_HL_IND>, 1, 2, "LD C, (HL)" },		//0x4e
+	{ &GameBoy::LD_r_r<REG_C, REG_A>, 1, 1, "LD C, A" },		//0x4f
+	{ &GameBoy::LD_r_r<REG_D, REG_B>, 1, 1, "LD D, B" },		//0x50
+	{ &GameBoy::LD_r_r<REG_D, REG_C>, 1, 1, "LD D, C" },		//0x51
+	{ &GameBoy::LD_r_r<REG_D, REG_D>, 1, 1, "LD D, D" },		//0x52
+	{ &GameBoy::LD_r_r<REG_D, REG_E>, 1, 1, "LD D, E" },		//0x53
+	{ &GameBoy::LD_r_r<REG_D, REG_H>, 1, 1, "LD D, H" },		//0x54
+	{ &GameBoy::LD_r_r<REG_D, REG_L>, 1, 1, "LD D, L" },		//0x55
+	{ &GameBoy::LD_r_r<REG_D, REG_HL_IND>, 1, 2, "LD D, (HL)" },		//0x56
+	{ &GameBoy::LD_r_r<REG_D, REG_A>, 1, 1, "LD D, A" },		//0x57
+	{ &GameBoy::LD_r_r<REG_E, REG_B>, 1, 1, "LD E, B" },		//0x58
+	{ &GameBoy::LD_r_r<REG_E, REG_C>, 1, 1, "LD E, C" },		//0x59
+	{ &GameBoy::LD_r_r<REG_E, REG_D>, 1, 1, "LD E, D" },		//0x5a
+	{ &GameBoy::LD_r_r<REG_E, REG_E>, 1, 1, "LD E, E" },		//0x5b
+	{ &GameBoy::LD_r_r<REG_E, REG_H>, 1, 1, "LD E, H" },		//0x5c
+	{ &GameBoy::LD_r_r<REG_E, REG_L>, 1, 1, "LD E, L" },		//0x5d
+	{ &GameBoy::LD_r_r<REG_E, REG_HL_IND>, 1, 2, "LD E, (HL)" },		//0x5e
+	{ &GameBoy::LD_r_r<REG_E, REG_A>, 1, 1, "LD E, A" },		//0x5f
+	{ &GameBoy::LD_r_r<REG_H, REG_B>, 1, 1, "LD H, B" },		//0x60
+	{ &GameBoy::LD_r_r<REG_H, REG_C>, 1, 1, "LD H, C" },		//0x61
+	{ &GameBoy::LD_r_r<REG_H, REG_D>, 1, 1, "LD H, D" },		//0x62
+	{ &GameBoy::LD_r_r<REG_H, REG_E>, 1, 1, "LD H, E" },		//0x63
+	{ &GameBoy::LD_r_r<REG_H, REG_H>, 1, 1, "LD H, H" },		//0x64
+	{ &GameBoy::LD_r_r<REG_H, REG_L>, 1, 1, "LD H, L" },		//0x65
+	{ &GameBoy::LD_r_r<REG_H, REG_HL_IND>, 1, 2, "LD H, (HL)" },		//0x66
+	{ &GameBoy::LD_r_r<REG_H, REG_A>, 1, 1, "LD H, A" },		//0x67
+	{ &GameBoy::LD_r_r<REG_L, REG_B>, 1, 1, "LD L, B" },		//0x68
+	{ &GameBoy::LD_r_r<REG_L, REG_C>, 1, 1, "LD L, C" },		//0x69
+	{ &GameBoy::LD_r_r<REG_L, REG_D>, 1, 1, "LD L, D" },		//0x6a
+	{ &GameBoy::LD_r_r<REG_L, REG_E>, 1, 1, "LD L, E" },		//0x6b
+	{ &GameBoy::LD_r_r<REG_L, REG_H>, 1, 1, "LD L, H" },		//0x6c
+	{ &GameBoy::LD_r_r<REG_L, REG_L>, 1, 1, "LD L, L" },		//0x6d
+	{ &GameBoy::LD_r_r<REG_L, REG_HL_IND>, 1, 2, "LD L, (HL)" },		//0x6e
+	{ &GameBoy::LD_r_r<REG_L, REG_A>, 1, 1, "LD L, A" },		//0x6f
+	{ &GameBoy::LD_r_r<REG_HL_IND, REG_B>, 1, 2, "LD (HL), B" },		//0x70
+	{ &GameBoy::LD_r_r<REG_HL_IND, REG_C>, 1, 2, "LD (HL), C" },		//0x71
+	{ &GameBoy::LD_r_r<REG_HL_IND, REG_D>, 1, 2, "LD (HL), D" },		//0x72
+	{ &GameBoy::LD_r_r<REG_HL_IND, REG_E>, 1, 2, "LD (HL), E" },		//0x73
+	{ &GameBoy::LD_r_r<REG_HL_IND, REG_H>, 1, 2, "LD (HL), H" },		//0x74
+	{ &GameBoy::LD_r_r<REG_HL_IND, REG_L>, 1, 2, "LD (HL), L" },		//0x75
+	{ &GameBoy::HALT, 1, 1, "HALT" },		//0x76
+	{ &GameBoy::LD_r_r<REG_HL_IND, REG_A>, 1, 2, "LD (HL), A" },		//0x77
+	{ &GameBoy::LD_r_r<REG_A, REG_B>, 1, 1, "LD A, B" },		//0x78
+	{ &GameBoy::LD_r_r<REG_A, REG_C>, 1, 1, "LD A, C" },		//0x79
+	{ &GameBoy::LD_r_r<REG_A, REG_D>, 1, 1, "LD A, D" },		//0x7a
+	{ &GameBoy::LD_r_r<REG_A, REG_E>, 1, 1, "LD A, E" },		//0x7b
+	{ &GameBoy::LD_r_r<REG_A, REG_H>, 1, 1, "LD A, H" },		//0x7c
+	{ &GameBoy::LD_r_r<REG_A, REG_L>, 1, 1, "LD A, L" },		//0x7d
+	{ &GameBoy::LD_r_r<REG_A, REG_HL_IND>, 1, 2, "LD A, (HL)" },		//0x7e
+	{ &GameBoy::LD_r_r<REG_A, REG_A>, 1, 1, "LD A, A" },		//0x7f
+	{ &GameBoy::ADD_A_r<REG_B>, 1, 1, "ADD A, B" },		//0x80
+	{ &GameBoy::ADD_A_r<REG_C>, 1, 1, "ADD A, C" },		//0x81
+	{ &GameBoy::ADD_A_r<REG_D>, 1, 1, "ADD A, D" },		//0x82
+	{ &GameBoy::ADD_A_r<REG_E>, 1, 1, "ADD A, E" },		//0x83
+	{ &GameBoy::ADD_A_r<REG_H>, 1, 1, "ADD A, H" },		//0x84
+	{ &GameBoy::ADD_A_r<REG_L>, 1, 1, "ADD A, L" },		//0x85
+	{ &GameBoy::ADD_A_r<REG_HL_IND>, 1, 2, "ADD A, (HL)" },		//0x86
+	{ &GameBoy::ADD_A_r<REG_A>, 1, 1, "ADD A, A" },		//0x87
+	{ &GameBoy::ADC_A_r<REG_B>, 1, 1, "ADC A, B" },		//0x88
+	{ &GameBoy::ADC_A_r<REG_C>, 1, 1, "ADC A, C" },		//0x89
+	{ &GameBoy::ADC_A_r<REG_D>, 1, 1, "ADC A, D" },		//0x8a
+	{ &GameBoy::ADC_A_r<REG_E>, 1, 1, "ADC A, E" },		//0x8b
+	{ &GameBoy::ADC_A_r<REG_H>, 1, 1, "ADC A, H" },		//0x8c
+	{ &GameBoy::ADC_A_r<REG_L>, 1, 1, "ADC A, L" },		//0x8d
+	{ &GameBoy::ADC_A_r<REG_HL_IND>, 1, 2, "ADC A, (HL)" },		//0x8e
+	{ &GameBoy::ADC_A_r<REG_A>, 1, 1, "ADC A, A" },		//0x8f
+	{ &GameBoy::SUB_r<REG_B>, 1, 1, "SUB B" },		//0x90
+	{ &GameBoy::SUB_r<REG_C>, 1, 1, "SUB C" },		//0x91
+	{ &GameBoy::SUB_r<REG_D>, 1, 1, "SUB D" },		//0x92
+	{ &GameBoy::SUB_r<REG_E>, 1, 1, "SUB E" },		//0x93
+	{ &GameBoy::SUB_r<REG_H>, 1, 1, "SUB H" },		//0x94
+	{ &GameBoy::SUB_r<REG_L>, 1, 1, "SUB L" },		//0x95
+	{ &GameBoy::SUB_r<REG_HL_IND>, 1, 2, "SUB (HL)" },		//0x96
+	{ &GameBoy::SUB_r<REG_A>, 1, 1, "SUB A" },		//0x97
+	{ &GameBoy::SBC_A_r<REG_B>, 1, 1, "SBC A, B" },		//0x98
+	{ &GameBoy::SBC_A_r<REG_C>, 1, 1, "SBC A, C" },		//0x99
+	{ &GameBoy::SBC_A_r<REG_D>, 1, 1, "SBC A, D" },		//0x9a
+	{ &GameBoy::SBC_A_r<REG_E>, 1, 1, "SBC A, E" },		//0x9b
+	{ &GameBoy::SBC_A_r<REG_H>, 1, 1, "SBC A, H" },		//0x9c
+	{ &GameBoy::SBC_A_r<REG_L>, 1, 1, "SBC A, L" },		//0x9d
+	{ &GameBoy::SBC_A_r<REG_HL_IND>, 1, 2, "SBC A, (HL)" },		//0x9e
+	{ &GameBoy::SBC_A_r<REG_A>, 1, 1, "SBC A, A" },		//0x9f
+	{ &GameBoy::AND_r<REG_B>, 1, 1, "AND B" },		//0xa0
+	{ &GameBoy::AND_r<REG_C>, 1, 1, "AND C" },		//0xa1
+	{ &GameBoy::AND_r<REG_D>, 1, 1, "AND D" },		//0xa2
+	{ &GameBoy::AND_r<REG_E>, 1, 1, "AND E" },		//0xa3
+	{ &GameBoy::AND_r<REG_H>, 1, 1, "AND H" },		//0xa4
+	{ &GameBoy::AND_r<REG_L>, 1, 1, "AND L" },		//0xa5
+	{ &GameBoy::AND_r<REG_HL_IND>, 1, 2, "AND (HL)" },		//0xa6
+	{ &GameBoy::AND_r<REG_A>, 1, 1, "AND A" },		//0xa7
+	{ &GameBoy::XOR_r<REG_B>, 1, 1, "XOR B" },		//0xa8
+	{ &GameBoy::XOR_r<REG_C>, 1, 1, "XOR C" },		//0xa9
+	{ &GameBoy::XOR_r<REG_D>, 1, 1, "XOR D" },		//0xaa
+	{ &GameBoy::XOR_r<REG_E>, 1, 1, "XOR E" },		//0xab
+	{ &GameBoy::XOR_r<REG_H>, 1, 1, "XOR H" },		//0xac
+	{ &GameBoy::XOR_r<REG_L>, 1, 1, "XOR L" },		//0xad
+	{ &GameBoy::XOR_r<REG_HL_IND>, 1, 2, "XOR (HL)" },		//0xae
+	{ &GameBoy::XOR_r<REG_A>, 1, 1, "XOR A" },		//0xaf
+	{ &GameBoy::OR_r<REG_B>, 1, 1, "OR B" },		//0xb0
+	{ &GameBoy::OR_r<REG_C>, 1, 1, "OR C" },		//0xb1
+	{ &GameBoy::OR_r<REG_D>, 1, 1, "OR D" },		//0xb2
+	{ &GameBoy::OR_r<REG_E>, 1, 1, "OR E" },		//0xb3
+	{ &GameBoy::OR_r<REG_H>, 1, 1, "OR H" },		//0xb4
+	{ &GameBoy::OR_r<REG_L>, 1, 1, "OR L" },		//0xb5
+	{ &GameBoy::OR_r<REG_HL_IND>, 1, 2, "OR (HL)" },		//0xb6
+	{ &GameBoy::OR_r<REG_A>, 1, 1, "OR A" },		//0xb7
+	{ &GameBoy::CP_r<REG_B>, 1, 1, "CP B" },		//0xb8
+	{ &GameBoy::CP_r<REG_C>, 1, 1, "CP C" },		//0xb9
+	{ &GameBoy::CP_r<REG_D>, 1, 1, "CP D" },		//0xba
+	{ &GameBoy::CP_r<REG_E>, 1, 1, "CP E" },		//0xbb
+	{ &GameBoy::CP_r<REG_H>, 1, 1, "CP H" },		//0xbc
+	{ &GameBoy::CP_r<REG_L>, 1, 1, "CP L" },		//0xbd
+	{ &GameBoy::CP_r<REG_HL_IND>, 1, 2, "CP (HL)" },		//0xbe
+	{ &GameBoy::CP_r<REG_A>, 1, 1, "CP A" },		//0xbf
+	{ &GameBoy::RET_cc<COND_NZ>, 1, 2, "RET NZ" },		//0xc0
+	{ &GameBoy::POP_rr<REG_BC>, 1, 3, "POP BC" },		//0xc1
+	{ &GameBoy::JP<COND_NZ>, 3, 3, "JP NZ, a16" },		//0xc2
+	{ &GameBoy::JP<COND_ALWAYS>, 3, 4, "JP a16" },		//0xc3
+	{ &GameBoy::CALL<COND_NZ>, 3, 3, "CALL NZ, a16" },		//0xc4
+	{ &GameBoy::PUSH_rr<REG_BC>, 1, 4, "PUSH BC" },		//0xc5
+	{ &GameBoy::ADD_A_r<REG_D8>, 2, 2, "ADD A, d8" },		//0xc6
+	{ &GameBoy::RST<0x00>, 1, 4, "RST 0x00" },		//0xc7
+	{ &GameBoy::RET_cc<COND_Z>, 1, 2, "RET Z" },		//0xc8
+	{ &GameBoy::RET, 1, 4, "RET" },		//0xc9
+	{ &GameBoy::JP<COND_Z>, 3, 3, "JP Z, a16" },		//0xca
+	{ &GameBoy::prefixed_execute, 2, 0, "PREFIX CB" },		//0xcb
+	{ &GameBoy::CALL<COND_Z>, 3, 3, "CALL Z, a16" },		//0xcc
+	{ &GameBoy::CALL<COND_ALWAYS>, 3, 6, "CALL a16" },		//0xcd
+	{ &GameBoy::ADC_A_r<REG_D8>, 2, 2, "ADC A, d8" },		//0xce
+	{ &GameBoy::RST<0x08>, 1, 4, "RST 0x08" },		//0xcf
+	{ &GameBoy::RET_cc<COND_NC>, 1, 2, "RET NC" },		//0xd0
+	{ &GameBoy::POP_rr<REG_DE>, 1, 3, "POP DE" },		//0xd1
+	{ &GameBoy::JP<COND_NC>, 3, 3, "JP NC, a16" },		//0xd2
+	{ &GameBoy::INVALID, 1, 0, "INVALID" },		//0xd3
+	{ &GameBoy::CALL<COND_NC>, 3, 3, "CALL NC, a16" },		//0xd4
+	{ &GameBoy::PUSH_rr<REG_DE>, 1, 4, "PUSH DE" },		//0xd5
+	{ &GameBoy::SUB_r<REG_D8>, 2, 2, "SUB d8" },		//0xd6
+	{ &GameBoy::RST<0x10>, 1, 4, "RST 0x10" },		//0xd7
+	{ &GameBoy::RET_cc<COND_C>, 1, 2, "RET C" },		//0xd8
+	{ &GameBoy::RETI, 1, 4, "RETI" },		//0xd9
+	{ &GameBoy::JP<COND_C>, 3, 3, "JP C, a16" },		//0xda
+	{ &GameBoy::INVALID, 1, 0, "INVALID" },		//0xdb
+	{ &GameBoy::CALL<COND_C>, 3, 3, "CALL C, a16" },		//0xdc
+	{ &GameBoy::INVALID, 1, 0, "INVALID" },		//0xdd
+	{ &GameBoy::SBC_A_r<REG_D8>, 2, 2, "SBC A, d8" },		//0xde
+	{ &GameBoy::RST<0x18>, 1, 4, "RST 0x18" },		//0xdf
+	{ &GameBoy::LDH_a8_A, 2, 3, "LDH (a8), A" },		//0xe0
+	{ &GameBoy::POP_rr<REG_HL>, 1, 3, "POP HL" },		//0xe1
+	{ &GameBoy::LD_pC_A, 1, 2, "LD (C), A" },		//0xe2
+	{ &GameBoy::INVALID, 1, 0, "INVALID" },		//0xe3
+	{ &GameBoy::INVALID, 1, 0, "INVALID" },		//0xe4
+	{ &GameBoy::PUSH_rr<REG_HL>, 1, 4, "PUSH HL" },		//0xe5
+	{ &GameBoy::AND_r<REG_D8>, 2, 2, "AND d8" },		//0xe6
+	{ &GameBoy::RST<0x20>, 1, 4, "RST 0x20" },		//0xe7
+	{ &GameBoy::ADD_SP_r8, 2, 4, "ADD SP, r8" },		//0xe8
+	{ &GameBoy::JP_HL, 1, 1, "JP HL" },		//0xe9
+	{ &GameBoy::LD_a16_A, 3, 4, "LD (a16), A" },		//0xea
+	{ &GameBoy::INVALID, 1, 0, "INVALID" },		//0xeb
+	{ &GameBoy::INVALID, 1, 0, "INVALID" },		//0xec
+	{ &GameBoy::INVALID, 1, 0, "INVALID" },		//0xed
+	{ &GameBoy::XOR_r<REG_D8>, 2, 2, "XOR d8" },		//0xee
+	{ &GameBoy::RST<0x28>, 1, 4, "RST 0x28" },		//0xef
+	{ &GameBoy::LDH_A_a8, 2, 3, "LDH A, (a8)" },		//0xf0
+	{ &GameBoy::POP_rr<REG_AF>, 1, 3, "POP AF" },		//0xf1
+	{ &GameBoy::LD_A_pC, 1, 2, "LD A, (C)" },		//0xf2
+	{ &GameBoy::DI, 1, 1, "DI" },		//0xf3
+	{ &GameBoy::INVALID, 1, 0, "INVALID" },		//0xf4
+	{ &GameBoy::PUSH_rr<REG_AF>, 1, 4, "PUSH AF" },		//0xf5
+	{ &GameBoy::OR_r<REG_D8>, 2, 2, "OR d8" },		//0xf6
+	{ &GameBoy::RST<0x30>, 1, 4, "RST 0x30" },		//0xf7
+	{ &GameBoy::LD_HL_SP_r8, 2, 3, "LD HL, SP + r8" },		//0xf8
+	{ &GameBoy::LD_SP_HL, 1, 2, "LD SP, HL" },		//0xf9
+	{ &GameBoy::LD_A_a16, 3, 4, "LD A, (a16)" },		//0xfa
+	{ &GameBoy::EI, 1, 1, "EI" },		//0xfb
+	{ &GameBoy::INVALID, 1, 0, "INVALID" },		//0xfc
+	{ &GameBoy::INVALID, 1, 0, "INVALID" },		//0xfd
+	{ &GameBoy::CP_r<REG_D8>, 2, 2, "CP d8" },		//0xfe
+	{ &GameBoy::RST<0x38>, 1, 4, "RST 0x38" },		//0xff
+};
+
+const opcode_info GameBoy::prefixedOpcodeTable[256] = {
+	{ &GameBoy::RLC_r<REG_B>, 2, 2, "RLC B" },		//0x00
+	{ &GameBoy::RLC_r<REG_C>, 2, 2, "RLC C" },		//0x01
+	{ &GameBoy::RLC_r<REG_D>, 2, 2, "RLC D" },		//0x02
+	{ &GameBoy::RLC_r<REG_E>, 2, 2, "RLC E" },		//0x03
+	{ &GameBoy::RLC_r<REG_H>, 2, 2, "RLC H" },		//0x04
+	{ &GameBoy::RLC_r<REG_L>, 2, 2, "RLC L" },		//0x05
+	{ &GameBoy::RLC_r<REG_HL_IND>, 2, 4, "RLC (HL)" },		//0x06
+	{ &GameBoy::RLC_r<REG_A>, 2, 2, "RLC A" },		//0x07
+	{ &GameBoy::RRC_r<REG_B>, 2, 2, "RRC B" },		//0x08
+	{ &GameBoy::RRC_r<REG_C>, 2, 2, "RRC C" },		//0x09
+	{ &GameBoy::RRC_r<REG_D>, 2, 2, "RRC D" },		//0x0a
+	{ &GameBoy::RRC_r<REG_E>, 2, 2, "RRC E" },		//0x0b
+	{ &GameBoy::RRC_r<REG_H>, 2, 2, "RRC H" },		//0x0c
+	{ &GameBoy::RRC_r<REG_L>, 2, 2, "RRC L" },		//0x0d
+	{ &GameBoy::RRC_r<REG_HL_IND>, 2, 4, "RRC (HL)" },		//0x0e
+	{ &GameBoy::RRC_r<REG_A>, 2, 2, "RRC A" },		//0x0f
+	{ &GameBoy::RL_r<REG_B>, 2, 2, "RL B" },		//0x10
+	{ &GameBoy::RL_r<REG_C>, 2, 2, "RL C" },		//0x11
+	{ &GameBoy::RL_r<REG_D>, 2, 2, "RL D" },		//0x12
+	{ &GameBoy::RL_r<REG_E>, 2, 2, "RL E" },		//0x13
+	{ &GameBoy::RL_r<REG_H>, 2, 2, "RL H" },		//0x14
+	{ &GameBoy::RL_r<REG_L>, 2, 2, "RL L" },		//0x15
+	{ &GameBoy::RL_r<REG_HL_IND>, 2, 4, "RL (HL)" },		//0x16
+	{ &GameBoy::RL_r<REG_A>, 2, 2, "RL A" },		//0x17
+	{ &GameBoy::RR_r<REG_B>, 2, 2, "RR B" },		//0x18
+	{ &GameBoy::RR_r<REG_C>, 2, 2, "RR C" },		//0x19
+	{ &GameBoy::RR_r<REG_D>, 2, 2, "RR D" },		//0x1a
+	{ &GameBoy::RR_r<REG_E>, 2, 2, "RR E" },		//0x1b
+	{ &GameBoy::RR_r<REG_H>, 2, 2, "RR H" },		//0x1c
+	{ &GameBoy::RR_r<REG_L>, 2, 2, "RR L" },		//0x1d
+	{ &GameBoy::RR_r<REG_HL_IND>, 2, 4, "RR (HL)" },		//0x1e
+	{ &GameBoy::RR_r<REG_A>, 2, 2, "RR A" },		//0x1f
+	{ &GameBoy::SLA_r<REG_B>, 2, 2, "SLA B" },		//0x20
+	{ &GameBoy::SLA_r<REG_C>, 2, 2, "SLA C" },		//0x21
+	{ &GameBoy::SLA_r<REG_D>, 2, 2, "SLA D" },		//0x22
+	{ &GameBoy::SLA_r<REG_E>, 2, 2, "SLA E" },		//0x23
+	{ &GameBoy::SLA_r<REG_H>, 2, 2, "SLA H" },		//0x24
+	{ &GameBoy::SLA_r<REG_L>, 2, 2, "SLA L" },		//0x25
+	{ &GameBoy::SLA_r<REG_HL_IND>, 2, 4, "SLA (HL)" },		//0x26
+	{ &GameBoy::SLA_r<REG_A>, 2, 2, "SLA A" },		//0x27
+	{ &GameBoy::SRA_r<REG_B>, 2, 2, "SRA B" },		//0x28
+	{ &GameBoy::SRA_r<REG_C>, 2, 2, "SRA C" },		//0x29
+	{ &GameBoy::SRA_r<REG_D>, 2, 2, "SRA D" },		//0x2a
+	{ &GameBoy::SRA_r<REG_E>, 2, 2, "SRA E" },		//0x2b
+	{ &GameBoy::SRA_r<REG_H>, 2, 2, "SRA H" },		//0x2c
+	{ &GameBoy::SRA_r<REG_L>, 2, 2, "SRA L" },		//0x2d
+	{ &GameBoy::SRA_r<REG_HL_IND>, 2, 4, "SRA (HL)" },		//0x2e
+	{ &GameBoy::SRA_r<REG_A>, 2, 2, "SRA A" },		//0x2f
+	{ &GameBoy::SWAP_r<REG_B>, 2, 2, "SWAP B" },		//0x30
+	{ &GameBoy::SWAP_r<REG_C>, 2, 2, "SWAP C" },		//0x31
+	{ &GameBoy::SWAP_r<REG_D>, 2, 2, "SWAP D" },		//0x32
+	{ &GameBoy::SWAP_r<REG_E>, 2, 2, "SWAP E" },		//0x33
+	{ &GameBoy::SWAP_r<REG_H>, 2, 2, "SWAP H" },		//0x34
+	{ &GameBoy::SWAP_r<REG_L>, 2, 2, "SWAP L" },		//0x35
+	{ &GameBoy::SWAP_r<REG_HL_IND>, 2, 4, "SWAP (HL)" },		//0x36
+	{ &GameBoy::SWAP_r<REG_A>, 2, 2, "SWAP A" },		//0x37
+	{ &GameBoy::SRL_r<REG_B>, 2, 2, "SRL B" },		//0x38
+	{ &GameBoy::SRL_r<REG_C>, 2, 2, "SRL C" },		//0x39
+	{ &GameBoy::SRL_r<REG_D>, 2, 2, "SRL D" },		//0x3a
+	{ &GameBoy::SRL_r<REG_E>, 2, 2, "SRL E" },		//0x3b
+	{ &GameBoy::SRL_r<REG_H>, 2, 2, "SRL H" },		//0x3c
+	{ &GameBoy::SRL_r<REG_L>, 2, 2, "SRL L" },		//0x3d
+	{ &GameBoy::SRL_r<REG_HL_IND>, 2, 4, "SRL (HL)" },		//0x3e
+	{ &GameBoy::SRL_r<REG_A>, 2, 2, "SRL A" },		//0x3f
+	{ &GameBoy::BIT_b_r<0, REG_B>, 2, 2, "BIT 0, B" },		//0x40
+	{ &GameBoy::BIT_b_r<0, REG_C>, 2, 2, "BIT 0, C" },		//0x41
+	{ &GameBoy::BIT_b_r<0, REG_D>, 2, 2, "BIT 0, D" },		//0x42
+	{ &GameBoy::BIT_b_r<0, REG_E>, 2, 2, "BIT 0, E" },		//0x43
+	{ &GameBoy::BIT_b_r<0, REG_H>, 2, 2, "BIT 0, H" },		//0x44
+	{ &GameBoy::BIT_b_r<0, REG_L>, 2, 2, "BIT 0, L" },		//0x45
+	{ &GameBoy::BIT_b_r<0, REG_HL_IND>, 2, 3, "BIT 0, (HL)" },		//0x46
+	{ &GameBoy::BIT_b_r<0, REG_A>, 2, 2, "BIT 0, A" },		//0x47
+	{ &GameBoy::BIT_b_r<1, REG_B>, 2, 2, "BIT 1, B" },		//0x48
+	{ &GameBoy::BIT_b_r<1, REG_C>, 2, 2, "BIT 1, C" },		//0x49
+	{ &GameBoy::BIT_b_r<1, REG_D>, 2, 2, "BIT 1, D" },		//0x4a
+	{ &GameBoy::BIT_b_r<1, REG_E>, 2, 2, "BIT 1, E" },		//0x4b
+	{ &GameBoy::BIT_b_r<1, REG_H>, 2, 2, "BIT 1, H" },		//0x4c
+	{ &GameBoy::BIT_b_r<1, REG_L>, 2, 2, "BIT 1, L" },		//0x4d
+	{ &GameBoy::BIT_b_r<1, REG_HL_IND>, 2, 3, "BIT 1, (HL)" },		//0x4e
+	{ &GameBoy::BIT_b_r<1, REG_A>, 2, 2, "BIT 1, A" },		//0x4f
+	{ &GameBoy::BIT_b_r<2, REG_B>, 2, 2, "BIT 2, B" },		//0x50
+	{ &GameBoy::BIT_b_r<2, REG_C>, 2, 2, "BIT 2, C" },		//0x51
+	{ &GameBoy::BIT_b_r<2, REG_D>, 2, 2, "BIT 2, D" },		//0x52
+	{ &GameBoy::BIT_b_r<2, REG_E>, 2, 2, "BIT 2, E" },		//0x53
+	{ &GameBoy::BIT_b_r<2, REG_H>, 2, 2, "BIT 2, H" },		//0x54
+	{ &GameBoy::BIT_b_r<2, REG_L>, 2, 2, "BIT 2, L" },		//0x55
+	{ &GameBoy::BIT_b_r<2, REG_HL_IND>, 2, 3, "BIT 2, (HL)" },		//0x56
+	{ &GameBoy::BIT_b_r<2, REG_A>, 2, 2, "BIT 2, A" },		//0x57
+	{ &GameBoy::BIT_b_r<3, REG_B>, 2, 2, "BIT 3, B" },		//0x58
+	{ &GameBoy::BIT_b_r<3, REG_C>, 2, 2, "BIT 3, C" },		//0x59
+	{ &GameBoy::BIT_b_r<3, REG_D>, 2, 2, "BIT 3, D" },		//0x5a
+	{ &GameBoy::BIT_b_r<3, REG_E>, 2, 2, "BIT 3, E" },		//0x5b
+	{ &GameBoy::BIT_b_r<3, REG_H>, 2, 2, "BIT 3, H" },		//0x5c
+	{ &GameBoy::BIT_b_r<3, REG_L>, 2, 2, "BIT 3, L" },		//0x5d
+	{ &GameBoy::BIT_b_r<3, REG_HL_IND>, 2, 3, "BIT 3, (HL)" },		//0x5e
+	{ &GameBoy::BIT_b_r<3, REG_A>, 2, 2, "BIT 3, A" },		//0x5f
+	{ &GameBoy::BIT_b_r<4, REG_B>, 2, 2, "BIT 4, B" },		//0x60
+	{ &GameBoy::BIT_b_r<4, REG_C>, 2, 2, "BIT 4, C" },		//0x61
+	{ &GameBoy::BIT_b_r<4, REG_D>, 2, 2, "BIT 4, D" },		//0x62
+	{ &GameBoy::BIT_b_r<4, REG_E>, 2, 2, "BIT 4, E" },		//0x63
+	{ &GameBoy::BIT_b_r<4, REG_H>, 2, 2, "BIT 4, H" },		//0x64
+	{ &GameBoy::BIT_b_r<4, REG_L>, 2, 2, "BIT 4, L" },		//0x65
+	{ &GameBoy::BIT_b_r<4, REG_HL_IND>, 2, 3, "BIT 4, (HL)" },		//0x66
+	{ &GameBoy::BIT_b_r<4, REG_A>, 2, 2, "BIT 4, A" },		//0x67
+	{ &GameBoy::BIT_b_r<5, REG_B>, 2, 2, "BIT 5, B" },		//0x68
+	{ &GameBoy::BIT_b_r<5, REG_C>, 2, 2, "BIT 5, C" },		//0x69
+	{ &GameBoy::BIT_b_r<5, REG_D>, 2, 2, "BIT 5, D" },		//0x6a
+	{ &GameBoy::BIT_b_r<5, REG_E>, 2, 2, "BIT 5, E" },		//0x6b
+	{ &GameBoy::BIT_b_r<5, REG_H>, 2, 2, "BIT 5, H" },		//0x6c
+	{ &GameBoy::BIT_b_r<5, REG_L>, 2, 2, "BIT 5, L" },		//0x6d
+	{ &GameBoy::BIT_b_r<5, REG_HL_IND>, 2, 3, "BIT 5, (HL)" },		//0x6e
+	{ &GameBoy::BIT_b_r<5, REG_A>, 2, 2, "BIT 5, A" },		//0x6f
+	{ &GameBoy::BIT_b_r<6, REG_B>, 2, 2, "BIT 6, B" },		//0x70
+	{ &GameBoy::BIT_b_r<6, REG_C>, 2, 2, "BIT 6, C" },		//0x71
+	{ &GameBoy::BIT_b_r<6, REG_D>, 2, 2, "BIT 6, D" },		//0x72
+	{ &GameBoy::BIT_b_r<6, REG_E>, 2, 2, "BIT 6, E" },		//0x73
+	{ &GameBoy::BIT_b_r<6, REG_H>, 2, 2, "BIT 6, H" },		//0x74
+	{ &GameBoy::BIT_b_r<6, REG_L>, 2, 2, "BIT 6, L" },		//0x75
+	{ &GameBoy::BIT_b_r<6, REG_HL_IND>, 2, 3, "BIT 6, (HL)" },		//0x76
+	{ &GameBoy::BIT_b_r<6, REG_A>, 2, 2, "BIT 6, A" },		//0x77
+	{ &GameBoy::BIT_b_r<7, REG_B>, 2, 2, "BIT 7, B" },		//0x78
+	{ &GameBoy::BIT_b_r<7, REG_C>, 2, 2, "BIT 7, C" },		//0x79
+	{ &GameBoy::BIT_b_r<7, REG_D>, 2, 2, "BIT 7, D" },		//0x7a
+	{ &GameBoy::BIT_b_r<7, REG_E>, 2, 2, "BIT 7, E" },		//0x7b
+	{ &GameBoy::BIT_b_r<7, REG_H>, 2, 2, "BIT 7, H" },		//0x7c
+	{ &GameBoy::BIT_b_r<7, REG_L>, 2, 2, "BIT 7, L" },		//0x7d
+	{ &GameBoy::BIT_b_r<7, REG_HL_IND>, 2, 3, "BIT 7, (HL)" },		//0x7e
+	{ &GameBoy::BIT_b_r<7, REG_A>, 2, 2, "BIT 7, A" },		//0x7f
+	{ &GameBoy::RES_b_r<0, REG_B>, 2, 2, "RES 0, B" },		//0x80
+	{ &GameBoy::RES_b_r<0, REG_C>, 2, 2, "RES 0, C" },		//0x81
+	{ &GameBoy::RES_b_r<0, REG_D>, 2, 2, "RES 0, D" },		//0x82
+	{ &GameBoy::RES_b_r<0, REG_E>, 2, 2, "RES 0, E" },		//0x83
+	{ &GameBoy::RES_b_r<0, REG_H>, 2, 2, "RES 0, H" },		//0x84
+	{ &GameBoy::RES_b_r<0, REG_L>, 2, 2, "RES 0, L" },		//0x85
+	{ &GameBoy::RES_b_r<0, REG_HL_IND>, 2, 4, "RES 0, (HL)" },		//0x86
+	{ &GameBoy::RES_b_r<0, REG_A>, 2, 2, "RES 0, A" },		//0x87
+	{ &GameBoy::RES_b_r<1, REG_B>, 2, 2, "RES 1, B" },		//0x88
+	{ &GameBoy::RES_b_r<1, REG_C>, 2, 2, "RES 1, C" },		//0x89
+	{ &GameBoy::RES_b_r<1, REG_D>, 2, 2, "RES 1, D" },		//0x8a
+	{ &GameBoy::RES_b_r<1, REG_E>, 2, 2, "RES 1, E" },		//0x8b
+	{ &GameBoy::RES_b_r<1, REG_H>, 2, 2, "RES 1, H" },		//0x8c
+	{ &GameBoy::RES_b_r<1, REG_L>, 2, 2, "RES 1, L" },		//0x8d
+	{ &GameBoy::RES_b_r<1, REG_HL_IND>, 2, 4, "RES 1, (HL)" },		//0x8e
+	{ &GameBoy::RES_b_r<1, REG_A>, 2, 2, "RES 1, A" },		//0x8f
+	{ &GameBoy::RES_b_r<2, REG_B>, 2, 2, "RES 2, B" },		//0x90
+	{ &GameBoy::RES_b_r<2, REG_C>, 2, 2, "RES 2, C" },		//0x91
+	{ &GameBoy::RES_b_r<2, REG_D>, 2, 2, "RES 2, D" },		//0x92
+	{ &GameBoy::RES_b_r<2, REG_E>, 2, 2, "RES 2, E" },		//0x93
+	{ &GameBoy::RES_b_r<2, REG_H>, 2, 2, "RES 2, H" },		//0x94
+	{ &GameBoy::RES_b_r<2, REG_L>, 2, 2, "RES 2, L" },		//0x95
+	{ &GameBoy::RES_b_r<2, REG_HL_IND>, 2, 4, "RES 2, (HL)" },		//0x96
+	{ &GameBoy::RES_b_r<2, REG_A>, 2, 2, "RES 2, A" },		//0x97
+	{ &GameBoy::RES_b_r<3, REG_B>, 2, 2, "RES 3, B" },		//0x98
+	{ &GameBoy::RES_b_r<3, REG_C>, 2, 2, "RES 3, C" },		//0x99
+	{ &GameBoy::RES_b_r<3, REG_D>, 2, 2, "RES 3, D" },		//0x9a
+	{ &GameBoy::RES_b_r<3, REG_E>, 2, 2, "RES 3, E" },		//0x9b
+	{ &GameBoy::RES_b_r<3, REG_H>, 2, 2, "RES 3, H" },		//0x9c
+	{ &GameBoy::RES_b_r<3, REG_L>, 2, 2, "RES 3, L" },		//0x9d
+	{ &GameBoy::RES_b_r<3, REG_HL_IND>, 2, 4, "RES 3, (HL)" },		//0x9e
+	{ &GameBoy::RES_b_r<3, REG_A>, 2, 2, "RES 3, A" },		//0x9f
+	{ &GameBoy::RES_b_r<4, REG_B>, 2, 2, "RES 4, B" },		//0xa0
+	{ &GameBoy::RES_b_r<4, REG_C>, 2, 2, "RES 4, C" },		//0xa1
+	{ &GameBoy::RES_b_r<4, REG_D>, 2, 2, "RES 4, D" },		//0xa2
+	{ &GameBoy::RES_b_r<4, REG_E>, 2, 2, "RES 4, E" },		//0xa3
+	{ &GameBoy::RES_b_r<4, REG_H>, 2, 2, "RES 4, H" },		//0xa4
+	{ &GameBoy::RES_b_r<4, REG_L>, 2, 2, "RES 4, L" },		//0xa5
+	{ &GameBoy::RES_b_r<4, REG_HL_IND>, 2, 4, "RES 4, (HL)" },		//0xa6
+	{ &GameBoy::RES_b_r<4, REG_A>, 2, 2, "RES 4, A" },		//0xa7
+	{ &GameBoy::RES_b_r<5, REG_B>, 2, 2, "RES 5, B" },		//0xa8
+	{ &GameBoy::RES_b_r<5, REG_C>, 2, 2, "RES 5, C" },		//0xa9
+	{ &GameBoy::RES_b_r<5, REG_D>, 2, 2, "RES 5, D" },		//0xaa
+	{ &GameBoy::RES_b_r<5, REG_E>, 2, 2, "RES 5, E" },		//0xab
+	{ &GameBoy::RES_b_r<5, REG_H>, 2, 2, "RES 5, H" },		//0xac
+	{ &GameBoy::RES_b_r<5, REG_L>, 2, 2, "RES 5, L" },		//0xad
+	{ &GameBoy::RES_b_r<5, REG_HL_IND>, 2, 4, "RES 5, (HL)" },		//0xae
+	{ &GameBoy::RES_b_r<5, REG_A>, 2, 2, "RES 5, A" },		//0xaf
+	{ &GameBoy::RES_b_r<6, REG_B>, 2, 2, "RES 6, B" },		//0xb0
+	{ &GameBoy::RES_b_r<6, REG_C>, 2, 2, "RES 6, C" },		//0xb1
+	{ &GameBoy::RES_b_r<6, REG_D>, 2, 2, "RES 6, D" },		//0xb2
+	{ &GameBoy::RES_b_r<6, REG_E>, 2, 2, "RES 6, E" },		//0xb3
+	{ &GameBoy::RES_b_r<6, REG_H>, 2, 2, "RES 6, H" },		//0xb4
+	{ &GameBoy::RES_b_r<6, REG_L>, 2, 2, "RES 6, L" },		//0xb5
+	{ &GameBoy::RES_b_r<6, REG_HL_IND>, 2, 4, "RES 6, (HL)" },		//0xb6
+	{ &GameBoy::RES_b_r<6, REG_A>, 2, 2, "RES 6, A" },		//0xb7
+	{ &GameBoy::RES_b_r<7, REG_B>, 2, 2, "RES 7, B" },		//0xb8
+	{ &GameBoy::RES_b_r<7, REG_C>, 2, 2, "RES 7, C" },		//0xb9
+	{ &GameBoy::RES_b_r<7, REG_D>, 2, 2, "RES 7, D" },		//0xba
+	{ &GameBoy::RES_b_r<7, REG_E>, 2, 2, "RES 7, E" },		//0xbb
+	{ &GameBoy::RES_b_r<7, REG_H>, 2, 2, "RES 7, H" },		//0xbc
+	{ &GameBoy::RES_b_r<7, REG_L>, 2, 2, "RES 7, L" },		//0xbd
+	{ &GameBoy::RES_b_r<7, REG_HL_IND>, 2, 4, "RES 7, (HL)" },		//0xbe
+	{ &GameBoy::RES_b_r<7, REG_A>, 2, 2, "RES 7, A" },		//0xbf
+	{ &GameBoy::SET_b_r<0, REG_B>, 2, 2, "SET 0, B" },		//0xc0
+	{ &GameBoy::SET_b_r<0, REG_C>, 2, 2, "SET 0, C" },		//0xc1
+	{ &GameBoy::SET_b_r<0, REG_D>, 2, 2, "SET 0, D" },		//0xc2
+	{ &GameBoy::SET_b_r<0, REG_E>, 2, 2, "SET 0, E" },		//0xc3
+	{ &GameBoy::SET_b_r<0, REG_H>, 2, 2, "SET 0, H" },		//0xc4
+	{ &GameBoy::SET_b_r<0, REG_L>, 2, 2, "SET 0, L" },		//0xc5
+	{ &GameBoy::SET_b_r<0, REG_HL_IND>, 2, 4, "SET 0, (HL)" },		//0xc6
+	{ &GameBoy::SET_b_r<0, REG_A>, 2, 2, "SET 0, A" },		//0xc7
+	{ &GameBoy::SET_b_r<1, REG_B>, 2, 2, "SET 1, B" },		//0xc8
+	{ &GameBoy::SET_b_r<1, REG_C>, 2, 2, "SET 1, C" },		//0xc9
+	{ &GameBoy::SET_b_r<1, REG_D>, 2, 2, "SET 1, D" },		//0xca
+	{ &GameBoy::SET_b_r<1, REG_E>, 2, 2, "SET 1, E" },		//0xcb
+	{ &GameBoy::SET_b_r<1, REG_H>, 2, 2, "SET 1, H" },		//0xcc
+	{ &GameBoy::SET_b_r<1, REG_L>, 2, 2, "SET 1, L" },		//0xcd
+	{ &GameBoy::SET_b_r<1, REG_HL_IND>, 2, 4, "SET 1, (HL)" },		//0xce
+	{ &GameBoy::SET_b_r<1, REG_A>, 2, 2, "SET 1, A" },		//0xcf
+	{ &GameBoy::SET_b_r<2, REG_B>, 2, 2, "SET 2, B" },		//0xd0
+	{ &GameBoy::SET_b_r<2, REG_C>, 2, 2, "SET 2, C" },		//0xd1
+	{ &GameBoy::SET_b_r<2, REG_D>, 2, 2, "SET 2, D" },		//0xd2
+	{ &GameBoy::SET_b_r<2, REG_E>, 2, 2, "SET 2, E" },		//0xd3
+	{ &GameBoy::SET_b_r<2, REG_H>, 2, 2, "SET 2, H" },		//0xd4
+	{ &GameBoy::SET_b_r<2, REG_L>, 2, 2, "SET 2, L" },		//0xd5
+	{ &GameBoy::SET_b_r<2, REG_HL_IND>, 2, 4, "SET 2, (HL)" },		//0xd6
+	{ &GameBoy::SET_b_r<2, REG_A>, 2, 2, "SET 2, A" },		//0xd7
+	{ &GameBoy::SET_b_r<3, REG_B>, 2, 2, "SET 3, B" },		//0xd8
+	{ &GameBoy::SET_b_r<3, REG_C>, 2, 2, "SET 3, C" },		//0xd9
+	{ &GameBoy::SET_b_r<3, REG_D>, 2, 2, "SET 3, D" },		//0xda
+	{ &GameBoy::SET_b_r<3, REG_E>, 2, 2, "SET 3, E" },		//0xdb
+	{ &GameBoy::SET_b_r<3, REG_H>, 2, 2, "SET 3, H" },		//0xdc
+	{ &GameBoy::SET_b_r<3, REG_L>, 2, 2, "SET 3, L" },		//0xdd
+	{ &GameBoy::SET_b_r<3, REG_HL_IND>, 2, 4, "SET 3, (HL)" },		//0xde
+	{ &GameBoy::SET_b_r<3, REG_A>, 2, 2, "SET 3, A" },		//0xdf
+	{ &GameBoy::SET_b_r<4, REG_B>, 2, 2, "SET 4, B" },		//0xe0
+	{ &GameBoy::SET_b_r<4, REG_C>, 2, 2, "SET 4, C" },		//0xe1
+	{ &GameBoy::SET_b_r<4, REG_D>, 2, 2, "SET 4, D" },		//0xe2
+	{ &GameBoy::SET_b_r<4, REG_E>, 2, 2, "SET 4, E" },		//0xe3
+	{ &GameBoy::SET_b_r<4, REG_H>, 2, 2, "SET 4, H" },		//0xe4
+	{ &GameBoy::SET_b_r<4, REG_L>, 2, 2, "SET 4, L" },		//0xe5
+	{ &GameBoy::SET_b_r<4, REG_HL_IND>, 2, 4, "SET 4, (HL)" },		//0xe6
+	{ &GameBoy::SET_b_r<4, REG_A>, 2, 2, "SET 4, A" },		//0xe7
+	{ &GameBoy::SET_b_r<5, REG_B>, 2, 2, "SET 5, B" },		//0xe8
+	{ &GameBoy::SET_b_r<5, REG_C>, 2, 2, "SET 5, C" },		//0xe9
+	{ &GameBoy::SET_b_r<5, REG_D>, 2, 2, "SET 5, D" },		//0xea
+	{ &GameBoy::SET_b_r<5, REG_E>, 2, 2, "SET 5, E" },		//0xeb
+	{ &GameBoy::SET_b_r<5, REG_H>, 2, 2, "SET 5, H" },		//0xec
+	{ &GameBoy::SET_b_r<5, REG_L>, 2, 2, "SET 5, L" },		//0xed
+	{ &GameBoy::SET_b_r<5, REG_HL_IND>, 2, 4, "SET 5, (HL)" },		//0xee
+	{ &GameBoy::SET_b_r<5, REG_A>, 2, 2, "SET 5, A" },		//0xef
+	{ &GameBoy::SET_b_r<6, REG_B>, 2, 2, "SET 6, B" },		//0xf0
+	{ &GameBoy::SET_b_r<6, REG_C>, 2, 2, "SET 6, C" },		//0xf1
+	{ &GameBoy::SET_b_r<6, REG_D>, 2, 2, "SET 6, D" },		//0xf2
+	{ &GameBoy::SET_b_r<6, REG_E>, 2, 2, "SET 6, E" },		//0xf3
+	{ &GameBoy::SET_b_r<6, REG_H>, 2, 2, "SET 6, H" },		//0xf4
+	{ &GameBoy::SET_b_r<6, REG_L>, 2, 2, "SET 6, L" },		//0xf5
+	{ &GameBoy::SET_b_r<6, REG_HL_IND>, 2, 4, "SET 6, (HL)" },		//0xf6
+	{ &GameBoy::SET_b_r<6, REG_A>, 2, 2, "SET 6, A" },		//0xf7
+	{ &GameBoy::SET_b_r<7, REG_B>, 2, 2, "SET 7, B" },		//0xf8
+	{ &GameBoy::SET_b_r<7, REG_C>, 2, 2, "SET 7, C" },		//0xf9
+	{ &GameBoy::SET_b_r<7, REG_D>, 2, 2, "SET 7, D" },		//0xfa
+	{ &GameBoy::SET_b_r<7, REG_E>, 2, 2, "SET 7, E" },		//0xfb
+	{ &GameBoy::SET_b_r<7, REG_H>, 2, 2, "SET 7, H" },		//0xfc
+	{ &GameBoy::SET_b_r<7, REG_L>, 2, 2, "SET 7, L" },		//0xfd
+	{ &GameBoy::SET_b_r<7, REG_HL_IND>, 2, 4, "SET 7, (HL)" },		//0xfe
+	{ &GameBoy::SET_b_r<7, REG_A>, 2, 2, "SET 7, A" },		//0xff
+};
+
+void GameBoy::SWAP_n(uint8_t& reg) {
 	reg = ((reg << 4) & 0xf0) | ((reg >> 4) & 0xf);
-	registers.flag.z = (reg == 0);
-	registers.flag.n = 0;
-	registers.flag.h = 0;
-	registers.flag.c = 0;
-	registers.pc += 1;
-	return 2;
+	setFlags(reg, 0, 0);
 }
 
-int GameBoy::SLA_n(uint8_t& reg) {
-	registers.flag.c = ((reg & 0x80) != 0);
+void GameBoy::SLA_n(uint8_t& reg) {
+	uint8_t carry = ((reg & 0x80) != 0);
 	reg <<= 1;
-	registers.flag.z = (reg == 0);
-	registers.flag.n = 0;
-	registers.flag.h = 0;
-
-	registers.pc += 1;
-	return 2;
+	setFlags(reg, 0, carry);
 }
 
-int GameBoy::SRA_n(uint8_t& reg) {
-	registers.flag.c = (reg & 0x1);
+void GameBoy::SRA_n(uint8_t& reg) {
+	uint8_t carry = (reg & 0x1);
 	reg = ((reg & 0x80) | (reg >> 1));
-	registers.flag.z = (reg == 0);
-	registers.flag.n = 0;
-	registers.flag.h = 0;
-
-	registers.pc += 1;
-	return 2;
+	setFlags(reg, 0, carry);
 }
 
-int GameBoy::RL_n(uint8_t& reg) {
-	uint8_t bit0 = registers.flag.c;
-	registers.flag.c = ((reg & 0x80) != 0);
+void GameBoy::RL_n(uint8_t& reg) {
+	uint8_t bit0 = registers.flags.carry;
+	uint8_t carry = ((reg & 0x80) != 0);
 	reg <<= 1;
 	reg |= bit0;
-	registers.flag.n = 0;
-	registers.flag.h = 0;
-	registers.flag.z = (reg == 0);
-
-	registers.pc += 1;
-	return 2;
+	setFlags(reg, 0, carry);
 }
 
-int GameBoy::RR_n(uint8_t& reg) {
-	uint8_t bit7 = registers.flag.c;
-	registers.flag.c = ((reg & 0x1) != 0);
+void GameBoy::RR_n(uint8_t& reg) {
+	uint8_t bit7 = registers.flags.carry;
+	uint8_t carry = (reg & 0x1);
 	reg >>= 1;
 	reg |= (bit7 << 7);
-	registers.flag.n = 0;
-	registers.flag.h = 0;
-	registers.flag.z = (reg == 0);
-
-	registers.pc += 1;
-	return 2;
+	setFlags(reg, 0, carry);
 }
 
 
-int GameBoy::RLC_n(uint8_t& reg) {
-	registers.flag.c = (reg >> 7) & 0x1;
+void GameBoy::RLC_n(uint8_t& reg) {
+	uint8_t carry = (reg >> 7) & 0x1;
 	reg <<= 1;
-	reg |= registers.flag.c;
-	registers.flag.n = 0;
-	registers.flag.h = 0;
-	registers.flag.z = (reg == 0);
-	registers.pc += 1;
-	return 2;
+	reg |= carry;
+	setFlags(reg, 0, carry);
 }
 
-int GameBoy::RRC_n(uint8_t& reg) {
-	registers.flag.c = (reg & 0x1);
+void GameBoy::RRC_n(uint8_t& reg) {
+	uint8_t carry = (reg & 0x1);
 	reg >>= 1;
-	reg |= (registers.flag.c << 7);
-
-	registers.flag.n = 0;
-	registers.flag.h = 0;
-	registers.flag.z = (reg == 0);
-	registers.pc += 1;
-	return 2;
+	reg |= (carry << 7);
+	setFlags(reg, 0, carry);
 }
 
-int GameBoy::LD_r1_r2(uint8_t& reg1, uint8_t& reg2) {
-	reg1 = reg2;
-	registers.pc += 1;
-	return 1;
-}
+void GameBoy::SBC_A_n(uint8_t reg) {
+	uint8_t cf = registers.flags.carry;
+	uint16_t n = reg + cf;
 
-int GameBoy::SBC_A_n(uint8_t& reg) {
-	uint16_t n = reg + registers.flag.c;
-	
-	//reg + carry-flag operation
-	registers.flag.h = (((reg & 0xf) + registers.flag.c) > 0xf);
-	registers.flag.c = (n > 0xff);
-	//subtruction operation
-	registers.flag.h |= ((registers.a & 0xf) < (n & 0xf));
-	registers.flag.c |= (registers.a < (n & 0xff));
+	registers.flags.carry = (registers.a < n);
+	registers.flags.op = FLAGS_SUB;
+	registers.flags.x = registers.a & 0xf;
+	registers.flags.y = (reg & 0xf) + cf;
 
 	registers.a -= (n & 0xff);
-	registers.flag.z = (registers.a == 0);
-	registers.flag.n = 1;
-
-	registers.pc += 1;
-	return 1;
+	registers.flags.result = registers.a;
 }
 
-int GameBoy::ADC_A_n(uint8_t& reg) {
-	uint16_t sum = registers.a + reg + registers.flag.c;
+void GameBoy::ADC_A_n(uint8_t reg) {
+	uint8_t cf = registers.flags.carry;
+	uint16_t sum = registers.a + reg + cf;
 
-	registers.flag.h = (((registers.a & 0xf) + (reg & 0xf) + registers.flag.c) > 0xf);
+	registers.flags.carry = (sum > 0xff);
+	registers.flags.op = FLAGS_ADD;
+	registers.flags.x = registers.a & 0xf;
+	registers.flags.y = (reg & 0xf) + cf;
 
-	registers.a += (reg + registers.flag.c);
-
-	registers.flag.z = (registers.a == 0);
-	registers.flag.n = 0;
-	registers.flag.c = (sum > 0xff);
-
-	registers.pc += 1;
-	return 1;
+	registers.a = sum & 0xff;
+	registers.flags.result = registers.a;
 }
 
-int GameBoy::OR_n(uint8_t& reg) {
+void GameBoy::OR_n(uint8_t reg) {
 	registers.a |= reg;
-
-	registers.flag.z = (registers.a == 0);
-	registers.flag.n = 0;
-	registers.flag.h = 0;
-	registers.flag.c = 0;
-
-	registers.pc += 1;
-	return 1;
+	setFlags(registers.a, 0, 0);
 }
 
-int GameBoy::AND_n(uint8_t& reg) {
+void GameBoy::AND_n(uint8_t reg) {
 	registers.a &= reg;
-
-	registers.flag.z = (registers.a == 0);
-	registers.flag.n = 0;
-	registers.flag.h = 1;
-	registers.flag.c = 0;
-
-	registers.pc += 1;
-	return 1;
+	setFlags(registers.a, FLAG_H, 0);
 }
 
-int GameBoy::XOR_n(uint8_t& reg) {
+void GameBoy::XOR_n(uint8_t reg) {
 	registers.a ^= reg;
-
-	registers.flag.z = (registers.a == 0);
-	registers.flag.n = 0;
-	registers.flag.h = 0;
-	registers.flag.c = 0;
-
-	registers.pc += 1;
-	return 1;
+	setFlags(registers.a, 0, 0);
 }
 
-int GameBoy::CP_n(uint8_t& reg) {
-	registers.flag.z = (registers.a == reg);
-	registers.flag.n = 1;
-	registers.flag.h = ((registers.a & 0xf) < (reg & 0xf));
-	registers.flag.c = (registers.a < reg);
-
-	registers.pc += 1;
-	return 1;
+void GameBoy::CP_n(uint8_t reg) {
+	registers.flags.result = registers.a - reg;
+	registers.flags.carry = (registers.a < reg);
+	registers.flags.op = FLAGS_SUB;
+	registers.flags.x = registers.a & 0xf;
+	registers.flags.y = reg & 0xf;
 }
 
-int GameBoy::SRL_n(uint8_t& reg) {
-	registers.flag.c = ((reg & 0x1) != 0);
+void GameBoy::SRL_n(uint8_t& reg) {
+	uint8_t carry = (reg & 0x1);
 	reg >>= 1;
-	reg &= 0x7f;
-	registers.flag.z = (reg == 0);
-	registers.flag.n = 0;
-	registers.flag.h = 0;
-
-	registers.pc += 1;
-	return 2;
+	setFlags(reg, 0, carry);
 }
 
-int GameBoy::SUB_n(uint8_t& reg) {
-	registers.flag.h = ((registers.a & 0xf) < (reg & 0xf));
-	registers.flag.c = (registers.a < reg);
+void GameBoy::SUB_n(uint8_t reg) {
+	registers.flags.carry = (registers.a < reg);
+	registers.flags.op = FLAGS_SUB;
+	registers.flags.x = registers.a & 0xf;
+	registers.flags.y = reg & 0xf;
 
 	registers.a -= reg;
-	registers.flag.z = (registers.a == 0);
-	registers.flag.n = 1;
-
-	registers.pc += 1;
-	return 1;
+	registers.flags.result = registers.a;
 }
 
-int GameBoy::ADD_n(uint8_t& reg) {
+void GameBoy::ADD_n(uint8_t reg) {
 	uint16_t sum = registers.a + reg;
 
-	registers.flag.h = (((registers.a & 0xf) + (reg & 0xf)) > 0xf);
-	registers.a += reg;
-	registers.flag.z = (registers.a == 0);
-	registers.flag.n = 0;
-	registers.flag.c = (sum > 0xff);
+	registers.flags.carry = (sum > 0xff);
+	registers.flags.op = FLAGS_ADD;
+	registers.flags.x = registers.a & 0xf;
+	registers.flags.y = reg & 0xf;
 
-	registers.pc += 1;
-	return 1;
+	registers.a = sum & 0xff;
+	registers.flags.result = registers.a;
 }
-
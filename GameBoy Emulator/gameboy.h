@@ -9,20 +9,78 @@
 #include "structures.h"
 #include "renderer.h"
 #include "sound.h"
+#include "profiler.h"
 
 class Cartridge;
 class Input;
+class DecodeCache;
+struct opcode_info;
+struct decoded_instruction;
+struct code_block;
+
+//device state changes that the cpu can't see by reading a register (interrupts, lcd modes).
+//The cpu runs without synchronizing the devices until the first scheduled event.
+//The divider has no event since its value is computed when read
+enum device_event {
+	EVENT_TIMER,
+	EVENT_PPU,
+	EVENT_COUNT
+};
+
+//idle time skipped in a frame, in clock cycles
+struct idle_stats {
+	uint32_t haltCycles;		//halted waiting for an interrupt
+	uint32_t pollCycles;		//in a loop polling memory or a register
+};
+
+//8 bit operands in the same order used by the instruction encoding.
+//REG_D8 is the immediate byte that follows the opcode
+enum reg8_operand {
+	REG_B,
+	REG_C,
+	REG_D,
+	REG_E,
+	REG_H,
+	REG_L,
+	REG_HL_IND,		//(HL)
+	REG_A,
+	REG_D8
+};
+
+//16 bit register pairs. AF is used only by PUSH and POP
+enum reg16_operand {
+	REG_BC,
+	REG_DE,
+	REG_HL,
+	REG_SP,
+	REG_AF
+};
+
+enum branch_condition {
+	COND_NZ,
+	COND_Z,
+	COND_NC,
+	COND_C,
+	COND_ALWAYS
+};
 
 class GameBoy {
 public:
 	GameBoy();
 	bool Init();
-	int nextInstruction();
+	int nextInstruction(int budget = 1);
 	int execute();
-	int prefixed_execute();
 	//bool* getSoundEnable();
 	void setClockSpeed(float multiplier);
 	void runFor(int cycles);
+	void invalidateCode(uint16_t gb_address);
+	void syncPending();
+	uint8_t readDivider();
+	uint8_t readTimer();
+	idle_stats getIdleStats();		//last frame
+#ifdef GB_PROFILE
+	void saveProfile();
+#endif
 private:
 	struct registers registers;
 	
@@ -34,29 +92,164 @@ private:
 	uint32_t time_clock;
 	std::chrono::steady_clock::time_point realTimePoint;
 
+	//decoding tables indexed by opcode. The second one is used for 0xCB prefixed opcodes
+	static const opcode_info opcodeTable[256];
+	static const opcode_info prefixedOpcodeTable[256];
+	DecodeCache* decodeCache;
+
+	//event scheduler. Events are keyed on registers.clock_cnt
+	uint64_t eventClock[EVENT_COUNT];
+	uint64_t nextEventClock;
+	bool eventsChanged;		//devices synchronized after the last scheduling
+
+	//deferred execution state
+	bool deferring;		//the cpu is running without synchronizing the devices
+	bool blockExit;		//set when the devices must be synchronized after the current instruction
+	int pendingCycles;		//machine cycles executed and not synchronized yet
+	bool joypadUpdated;		//new joypad state not processed yet
+
+	idle_stats idleStats;		//current frame
+	idle_stats lastIdleStats;
+
+#ifdef GB_PROFILE
+	Profiler* profiler;
+#endif
 	
+	void decode(uint16_t gb_address, decoded_instruction& instr);
+	code_block* getBlock(uint16_t pc);
+	code_block* buildBlock(uint16_t pc);
+	static bool isBlockEnd(const decoded_instruction& instr, uint8_t& branchCycles);
+	static bool isIdleLoop(const code_block& block, uint16_t pc, uint16_t end);
+	static bool sameCpuState(const struct registers& r1, const struct registers& r2);
+	int skipHalt(int budget);
+	int skipIdleLoop(const code_block& block, int startLimit);
+	int runBlock(const code_block& block, int budget);
+	int interpretBlock(const code_block& block, bool fits, int limit, int startLimit);
+	void scheduleEvents();
+	int cyclesToNextEvent();
+	void flushPending();
+	void updateDivider(int cycles);
+	void syncDevices(unsigned int m_cycles, int cycles);
 	int handleInterrupt(void);
 	void handleTimer(int cycles);
+	bool timerSingleStep(int divider);
 	void handleJoypad(void);
 	void handleSerial(void);
 
-	int RL_n(uint8_t& reg);
-	int RR_n(uint8_t& reg);
-	int RLC_n(uint8_t& reg);
-	int RRC_n(uint8_t& reg);
-	int SWAP_n(uint8_t& reg);
-	int LD_r1_r2(uint8_t& reg1, uint8_t& reg2);
-	int SLA_n(uint8_t& reg);
-	int SRA_n(uint8_t& reg);
-	int SBC_A_n(uint8_t& reg);
-	int ADC_A_n(uint8_t& reg);
-	int OR_n(uint8_t& reg);
-	int AND_n(uint8_t& reg);
-	int XOR_n(uint8_t& reg);
-	int CP_n(uint8_t& reg);
-	int SRL_n(uint8_t& reg);
-	int SUB_n(uint8_t& reg);
-	int ADD_n(uint8_t& reg);
+	//register access by operand encoding
+	template <int r> uint8_t readReg8(uint16_t operand);
+	template <int r> void writeReg8(uint8_t value);
+	template <int rr> uint16_t readReg16();
+	template <int rr> void writeReg16(uint16_t value);
+	template <int cc> bool checkCondition();
+	static uint8_t packFlags(const lazy_flags& flags);
+	void unpackFlags(uint8_t f);
+	void setFlags(uint8_t result, uint8_t nh, uint8_t carry);
+	void push(uint16_t value);
+	uint16_t pop();
+
+	//ALU helpers. They only update the registers and the flags
+	void RL_n(uint8_t& reg);
+	void RR_n(uint8_t& reg);
+	void RLC_n(uint8_t& reg);
+	void RRC_n(uint8_t& reg);
+	void SWAP_n(uint8_t& reg);
+	void SLA_n(uint8_t& reg);
+	void SRA_n(uint8_t& reg);
+	void SRL_n(uint8_t& reg);
+	void SBC_A_n(uint8_t n);
+	void ADC_A_n(uint8_t n);
+	void OR_n(uint8_t n);
+	void AND_n(uint8_t n);
+	void XOR_n(uint8_t n);
+	void CP_n(uint8_t n);
+	void SUB_n(uint8_t n);
+	void ADD_n(uint8_t n);
+
+	//opcode handlers. The pc already points to the next instruction when they are called,
+	//the operand holds the immediate bytes (d8, d16, r8 or the 0xCB opcode).
+	//They return the number of machine cycles used
+	int NOP(uint16_t operand);
+	int STOP(uint16_t operand);
+	int HALT(uint16_t operand);
+	int DI(uint16_t operand);
+	int EI(uint16_t operand);
+	int INVALID(uint16_t operand);
+	int prefixed_execute(uint16_t operand);
+	template <int r> int LD_r_d8(uint16_t operand);
+	template <int r1, int r2> int LD_r_r(uint16_t operand);
+	template <int rr> int LD_rr_d16(uint16_t operand);
+	template <int rr> int LD_pRR_A(uint16_t operand);
+	template <int rr> int LD_A_pRR(uint16_t operand);
+	int LD_HLI_A(uint16_t operand);
+	int LD_HLD_A(uint16_t operand);
+	int LD_A_HLI(uint16_t operand);
+	int LD_A_HLD(uint16_t operand);
+	int LD_a16_SP(uint16_t operand);
+	int LDH_a8_A(uint16_t operand);
+	int LDH_A_a8(uint16_t operand);
+	int LD_pC_A(uint16_t operand);
+	int LD_A_pC(uint16_t operand);
+	int LD_a16_A(uint16_t operand);
+	int LD_A_a16(uint16_t operand);
+	int LD_HL_SP_r8(uint16_t operand);
+	int LD_SP_HL(uint16_t operand);
+	template <int rr> int PUSH_rr(uint16_t operand);
+	template <int rr> int POP_rr(uint16_t operand);
+	template <int r> int INC_r(uint16_t operand);
+	template <int r> int DEC_r(uint16_t operand);
+	template <int rr> int INC_rr(uint16_t operand);
+	template <int rr> int DEC_rr(uint16_t operand);
+	template <int rr> int ADD_HL_rr(uint16_t operand);
+	int ADD_SP_r8(uint16_t operand);
+	template <int r> int ADD_A_r(uint16_t operand);
+	template <int r> int ADC_A_r(uint16_t operand);
+	template <int r> int SUB_r(uint16_t operand);
+	template <int r> int SBC_A_r(uint16_t operand);
+	template <int r> int AND_r(uint16_t operand);
+	template <int r> int XOR_r(uint16_t operand);
+	template <int r> int OR_r(uint16_t operand);
+	template <int r> int CP_r(uint16_t operand);
+	int DAA(uint16_t operand);
+	int CPL(uint16_t operand);
+	int SCF(uint16_t operand);
+	int CCF(uint16_t operand);
+	int RLCA(uint16_t operand);
+	int RRCA(uint16_t operand);
+	int RLA(uint16_t operand);
+	int RRA(uint16_t operand);
+	template <int cc> int JR(uint16_t operand);
+	template <int cc> int JP(uint16_t operand);
+	int JP_HL(uint16_t operand);
+	template <int cc> int CALL(uint16_t operand);
+	template <int cc> int RET_cc(uint16_t operand);
+	int RET(uint16_t operand);
+	int RETI(uint16_t operand);
+	template <uint16_t addr> int RST(uint16_t operand);
+
+	//0xCB prefixed opcode handlers
+	template <int r> int RLC_r(uint16_t operand);
+	template <int r> int RRC_r(uint16_t operand);
+	template <int r> int RL_r(uint16_t operand);
+	template <int r> int RR_r(uint16_t operand);
+	template <int r> int SLA_r(uint16_t operand);
+	template <int r> int SRA_r(uint16_t operand);
+	template <int r> int SWAP_r(uint16_t operand);
+	template <int r> int SRL_r(uint16_t operand);
+	template <int b, int r> int BIT_b_r(uint16_t operand);
+	template <int b, int r> int RES_b_r(uint16_t operand);
+	template <int b, int r> int SET_b_r(uint16_t operand);
+};
+
+//handler of a decoded opcode. Declared after GameBoy so that the pointer to member
+//uses the single inheritance representation
+typedef int (GameBoy::*opcode_handler)(uint16_t operand);
+
+struct opcode_info {
+	opcode_handler handler;
+	uint8_t length;		//instruction length in bytes, opcode included
+	uint8_t cycles;		//machine cycles used. For conditional branches the not taken case
+	const char* mnemonic;
 };
 
 
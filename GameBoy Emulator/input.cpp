@@ -75,6 +75,11 @@ void Input::beginNewFrame() {
 	if (wasKeyReleased(SDL_SCANCODE_F3)) {
 		_memory->saveCartridgeState();
 	}
+#ifdef GB_PROFILE
+	if (wasKeyReleased(SDL_SCANCODE_F4)) {
+		_gameboy->saveProfile();
+	}
+#endif
 
 }
 
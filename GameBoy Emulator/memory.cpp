@@ -3,21 +3,45 @@
 #include "globals.h"
 #include "sound.h"
 #include "ppu.h"
+#include "gameboy.h"
 
 #include <fstream>
 #include <string>
-#include <mutex>
+#include <algorithm>
+#include <string.h>
 
 bool _GBC_Mode;
 
-Memory::Memory() {
-	
+//scales the 5 bit channels to 8 bits
+static uint32_t linearColorCurve(uint16_t color) {
+	SDL_Color c = { (uint8_t)((color & 0x1f) * 8.2), (uint8_t)(((color >> 5) & 0x1f) * 8.2),
+		(uint8_t)(((color >> 10) & 0x1f) * 8.2), 255 };
+	uint32_t rgba;
+	memcpy(&rgba, &c, 4);
+	return rgba;
+}
 
+Memory::Memory() {
+	colorCurve = linearColorCurve;
+	paletteGeneration = 0;
+	memset(dmgShades, 0, sizeof(dmgShades));
+	memset(dmgColors, 0, sizeof(dmgColors));
+	memset(dmgShadeIndexes, 0, sizeof(dmgShadeIndexes));
+	memset(bgColors, 0, sizeof(bgColors));
+	memset(spriteColors, 0, sizeof(spriteColors));
+	saveRequested = false;
+	vramGeneration = 0;
+	oamGeneration = 0;
+	memset(tileGeneration, 0, sizeof(tileGeneration));
+	memset(mapRowGeneration, 0, sizeof(mapRowGeneration));
 }
 
 void Memory::Init(const char* rom_filename) {
 
-	this->cart = new Cartridge(rom_filename);
+	this->cart = new Cartridge(rom_filename);		//sets the cgb mode
+
+	readFunc = _GBC_Mode ? &Memory::readModel<true> : &Memory::readModel<false>;
+	writeFunc = _GBC_Mode ? &Memory::writeModel<true> : &Memory::writeModel<false>;
 
 	vram = (uint8_t**)(calloc(2, sizeof(uint8_t*)));
 	vram[0] = (uint8_t*)(calloc(0x2000, sizeof(uint8_t)));
@@ -36,7 +60,14 @@ void Memory::Init(const char* rom_filename) {
 	load_bootrom();
 	
 	memset(this->gb_mem, 0, sizeof(this->gb_mem));
+	memset(bg_palette_mem, 0, sizeof(bg_palette_mem));
+	memset(sprite_palette_mem, 0, sizeof(sprite_palette_mem));
 	io_map->JOYP = 0xff;
+	mapPages();
+	setColorCurve(colorCurve);
+	for (int i = 0; i < 3; i++) {
+		updateDmgColors(i);
+	}
 
 }
 
@@ -89,9 +120,13 @@ bool Memory::load_bootrom() {
 }
 
 void Memory::saveCartridgeState() {
-	cart_ram_AccessMutex.lock();
-	cart->saveState();
-	cart_ram_AccessMutex.unlock();
+	saveRequested = true;
+}
+
+//called between frames, when the cartridge ram is consistent
+void Memory::handleSaveRequest() {
+	if (saveRequested.exchange(false))
+		cart->saveState();
 }
 
 uint8_t* Memory::getVram(void) {
@@ -116,8 +151,60 @@ uint8_t* Memory::getOam() {
 }
 
 
-//translate the gameboy address into a real memory address and read a byte
-uint8_t Memory::read(uint16_t gb_address) {
+void Memory::mapPage(int page, uint8_t* data, bool writable) {
+	readPages[page] = data;
+	writePages[page] = writable ? data : nullptr;
+}
+
+void Memory::mapPages() {
+	mapCartridge();
+	mapVram();
+	mapWram();
+	for (int page = 0xe0; page <= 0xfe; page++) {		//echo ram and oam
+		mapPage(page, gb_mem + (page << 8), true);
+	}
+	mapPage(0xff, nullptr, false);		//io and hram
+}
+
+//rom writes go to the mbc. Disabled ram and rtc registers use the handler
+void Memory::mapCartridge() {
+	for (int page = 0; page < 0x80; page++) {
+		mapPage(page, cart->getRomPointer(page << 8), false);
+	}
+	//ram smaller than the window is mirrored, the pointers wrap inside the ram
+	for (int page = 0xa0; page <= 0xbf; page++) {
+		mapPage(page, cart->getRamPointer(page << 8), true);
+	}
+
+	if (io_map->BRC == 0) {		//bootstrap rom
+		mapPage(0x00, boot_rom0, false);
+		if (_GBC_Mode) {
+			for (int page = 0x02; page <= 0x08; page++) {
+				mapPage(page, boot_rom1 + ((page - 0x02) << 8), false);
+			}
+		}
+	}
+}
+
+void Memory::mapVram() {
+	uint8_t* bank = _GBC_Mode ? vram[io_map->VBK & 0x1] : vram[0];
+	for (int page = 0x80; page <= 0x9f; page++) {
+		mapPage(page, bank + ((page - 0x80) << 8), true);
+	}
+}
+
+void Memory::mapWram() {
+	uint8_t* bank = _GBC_Mode ? wram_banks[getWramBank() - 1] : gb_mem + 0xd000;
+	for (int page = 0xc0; page <= 0xcf; page++) {
+		mapPage(page, gb_mem + (page << 8), true);
+	}
+	for (int page = 0xd0; page <= 0xdf; page++) {
+		mapPage(page, bank + ((page - 0xd0) << 8), true);
+	}
+}
+
+template <bool cgb>
+uint8_t Memory::readModel(uint16_t gb_address) {
 
 	//cpu can't access vram during video mode 3
 	/*if (gb_address >= 0x8000 && gb_address < 0xa000 && 
@@ -129,7 +216,7 @@ uint8_t Memory::read(uint16_t gb_address) {
 		return this->boot_rom0[gb_address];
 	}
 
-	if (_GBC_Mode) {
+	if constexpr (cgb) {
 		//bank 1-7 of wram
 		if (gb_address >= 0xd000 && gb_address <= 0xdfff) {
 			return wram_banks[(io_map->SVBK == 0 ? 1 : io_map->SVBK & 0x7) - 1][gb_address - 0xd000];
@@ -148,39 +235,130 @@ uint8_t Memory::read(uint16_t gb_address) {
 	}
 
 	if (gb_address >= 0x8000 && gb_address <= 0x9fff) {		//vram
-		if (_GBC_Mode) return vram[io_map->VBK & 0x1][gb_address & 0x7fff];
+		if constexpr (cgb) return vram[io_map->VBK & 0x1][gb_address & 0x7fff];
 		return vram[0][gb_address & 0x7fff];
 	}
 
 	if ((gb_address >= 0 && gb_address <= 0x7fff) || (gb_address >= 0xa000 && gb_address <= 0xbfff)) {		//cartridge address
-		cart_ram_AccessMutex.lock();
-		uint8_t byte = this->cart->read(gb_address);
-		cart_ram_AccessMutex.unlock();
-		return byte;
+		return this->cart->read(gb_address);
 	}
 
+	//the divider and the timer can be behind the cpu
+	if (gb_address == 0xff04)
+		return _gameboy->readDivider();
+	if (gb_address == 0xff05)
+		return _gameboy->readTimer();
+
 	return this->gb_mem[gb_address];
 }
 
-SDL_Color Memory::getBackgroundColor(int palette, int num) {
-	
-	color_palette *gb_c = (color_palette*)&bg_palette_mem[(palette * 4 + num) * 2];
-	SDL_Color c = { gb_c->red * 8.2, gb_c->green * 8.2, gb_c->blue * 8.2, 255 };
-	return c;
+//return the offset in the rom file of a cartridge rom address or -1 if the bootstrap rom is mapped there
+int32_t Memory::getRomOffset(uint16_t gb_address) {
+	if (this->io_map->BRC == 0) {
+		if (gb_address < 0x100)
+			return -1;
+		if (_GBC_Mode && gb_address >= 0x200 && gb_address <= 0x8ff)
+			return -1;
+	}
+	return this->cart->getRomOffset(gb_address);
+}
+
+uint32_t Memory::getRomSize() {
+	return this->cart->getRomSize();
+}
+
+//wram bank mapped at 0xd000 - 0xdfff
+int Memory::getWramBank() {
+	if (!_GBC_Mode)
+		return 1;
+	return (io_map->SVBK == 0 ? 1 : io_map->SVBK & 0x7);
 }
 
-const color_palette const* Memory::getBackgroundPalette() {
-	return (color_palette*)bg_palette_mem;
+const uint32_t* Memory::getBackgroundColors() {
+	return bgColors;
 }
 
-SDL_Color Memory::getSpriteColor(int palette, int num) {
-	color_palette* gb_c = (color_palette*)&sprite_palette_mem[(palette * 4 + num) * 2];
-	SDL_Color c = { gb_c->red * 8.2, gb_c->green * 8.2, gb_c->blue * 8.2, 255 };
-	return c;
+const uint32_t* Memory::getSpriteColors() {
+	return spriteColors;
+}
+
+const uint32_t* Memory::getDmgColors(int palette) {
+	return dmgColors[palette];
+}
+
+const uint8_t* Memory::getDmgShadeIndexes(int palette) {
+	return dmgShadeIndexes[palette];
+}
+
+const uint32_t* Memory::getDmgShades() {
+	return dmgShades;
+}
+
+void Memory::setDmgShades(const SDL_Color* shades) {
+	memcpy(dmgShades, shades, sizeof(dmgShades));
+	for (int i = 0; i < 3; i++) {
+		updateDmgColors(i);
+	}
+}
+
+//the curve is applied when the tables are updated, so it has no cost for the pixels
+void Memory::setColorCurve(color_curve curve) {
+	colorCurve = curve;
+	for (int i = 0; i < 32; i++) {
+		updateCgbColor(bg_palette_mem, bgColors, i);
+		updateCgbColor(sprite_palette_mem, spriteColors, i);
+	}
+}
+
+uint64_t Memory::getPaletteGeneration() {
+	return paletteGeneration;
+}
+
+//the generation changes only with the colours, games often write the same palette every frame
+void Memory::updateCgbColor(const uint8_t* paletteMem, uint32_t* colors, int index) {
+	uint32_t color = colorCurve(paletteMem[index * 2] | (paletteMem[index * 2 + 1] << 8));
+	if (color != colors[index]) {
+		colors[index] = color;
+		paletteGeneration++;
+	}
+}
+
+void Memory::updateDmgColors(int palette) {
+	uint8_t reg = gb_mem[0xff47 + palette];
+	for (int i = 0; i < 4; i++) {
+		uint8_t shade = (reg >> (i * 2)) & 0x3;
+		if (shade != dmgShadeIndexes[palette][i] || dmgShades[shade] != dmgColors[palette][i]) {
+			dmgShadeIndexes[palette][i] = shade;
+			dmgColors[palette][i] = dmgShades[shade];
+			paletteGeneration++;
+		}
+	}
 }
 
 //translate the gameboy address into a real memory address and write a byte
 void Memory::write(uint16_t gb_address, uint8_t value) {
+	uint8_t* page = writePages[gb_address >> 8];
+	if (page == nullptr) {
+		(this->*writeFunc)(gb_address, value);
+		return;
+	}
+	uint8_t& byte = page[gb_address & 0xff];
+	if (gb_address >= 0x8000 && gb_address <= 0x9fff) {		//vram
+		if (byte != value) {
+			byte = value;
+			markVram(gb_address, 1);
+		}
+		return;
+	}
+	if (gb_address >= 0xfe00 && gb_address <= 0xfe9f && byte != value)		//oam
+		oamGeneration++;
+	byte = value;
+	if (gb_address >= 0xc000 && gb_address <= 0xdfff)		//wram can contain code
+		_gameboy->invalidateCode(gb_address);
+}
+
+template <bool cgb>
+void Memory::writeModel(uint16_t gb_address, uint8_t value) {
 
 	//cpu can't access vram during video mode 3
 	/*if (gb_address >= 0x8000 && gb_address < 0xa000 &&
@@ -193,21 +371,29 @@ void Memory::write(uint16_t gb_address, uint8_t value) {
 	}
 
 	if (gb_address >= 0x8000 && gb_address <= 0x9fff) {		//vram
-		if (_GBC_Mode) {
-			vram[io_map->VBK & 0x1][gb_address & 0x7fff] = value;
-			return;
+		uint8_t& byte = cgb ? vram[io_map->VBK & 0x1][gb_address & 0x7fff] : vram[0][gb_address & 0x7fff];
+		if (byte != value) {
+			byte = value;
+			markVram(gb_address, 1);
 		}
-		vram[0][gb_address & 0x7fff] = value;
 		return;
 	}
 
+	//io and mbc registers can change the timing of the other components
+	if (gb_address <= 0x7fff || (gb_address >= 0xff00 && gb_address <= 0xff7f) || gb_address == 0xffff)
+		_gameboy->syncPending();
+
 	if ((gb_address >= 0 && gb_address <= 0x7fff) || (gb_address >= 0xa000 && gb_address <= 0xbfff)) {		//cartridge address
-		cart_ram_AccessMutex.lock();
 		this->cart->write(gb_address, value);
-		cart_ram_AccessMutex.unlock();
+		if (gb_address <= 0x7fff)		//mbc register
+			mapCartridge();
 		return;
 	}
 
+	//wram and hram can contain code
+	if ((gb_address >= 0xc000 && gb_address <= 0xdfff) || gb_address >= 0xff80)
+		_gameboy->invalidateCode(gb_address);
+
 	//writing any value to the divider register resets it to 0
 	if (gb_address == 0xff04) value = 0;
 	if (gb_address == 0xff4d) {	//double speed register
@@ -215,7 +401,7 @@ void Memory::write(uint16_t gb_address, uint8_t value) {
 		return;
 	}
 
-	if (_GBC_Mode) {
+	if constexpr (cgb) {
 
 		if (gb_address >= 0xd000 && gb_address <= 0xdfff) {
 			wram_banks[(io_map->SVBK == 0 ? 1 : io_map->SVBK & 0x7) - 1][gb_address - 0xd000] = value;
@@ -223,11 +409,13 @@ void Memory::write(uint16_t gb_address, uint8_t value) {
 
 		if (gb_address == 0xff69) {		//write a byte to the bg palette memory
 			bg_palette_mem[io_map->PLT.bg_palette_index] = value;
+			updateCgbColor(bg_palette_mem, bgColors, io_map->PLT.bg_palette_index >> 1);
 			io_map->PLT.bg_palette_index += io_map->PLT.bg_inc;
 			return;
 		}
 		if (gb_address == 0xff6b) {		//write a byte to the sprite palette memory
 			sprite_palette_mem[io_map->PLT.sprite_palette_index] = value;
+			updateCgbColor(sprite_palette_mem, spriteColors, io_map->PLT.sprite_palette_index >> 1);
 			io_map->PLT.sprite_palette_index += io_map->PLT.sprite_inc;
 			return;
 		}
@@ -242,9 +430,11 @@ void Memory::write(uint16_t gb_address, uint8_t value) {
 		return;
 	}
 
+	if (gb_address >= 0xfe00 && gb_address <= 0xfe9f && this->gb_mem[gb_address] != value)		//oam
+		oamGeneration++;
 	this->gb_mem[gb_address] = value;
 
-	if (_GBC_Mode) {
+	if constexpr (cgb) {
 		if (gb_address == 0xff55) {		//gdma/hdma
 			if (io_map->HDMA.transfer_mode == 0 && hdma_active == 1) {		//pause hdma
 				hdma_active = 0;
@@ -257,19 +447,99 @@ void Memory::write(uint16_t gb_address, uint8_t value) {
 
 	if (gb_address == 0xff46)
 		oam_dma_copy();
+	if (gb_address >= 0xff47 && gb_address <= 0xff49)		//dmg palettes
+		updateDmgColors(gb_address - 0xff47);
+
+	if (gb_address == 0xff50)		//bootstrap rom disabled
+		mapCartridge();
+	if constexpr (cgb) {
+		if (gb_address == 0xff4f)
+			mapVram();
+		if (gb_address == 0xff70)
+			mapWram();
+	}
 
 }
 
-//copy the memory to oam region instantly
-void Memory::oam_dma_copy(void) {
+//a vram range of the current bank changed. The range is inside a page
+void Memory::markVram(uint16_t gb_address, int length) {
+
+	int bank = _GBC_Mode ? (io_map->VBK & 0x1) : 0;
+	uint64_t generation = ++vramGeneration;
+	uint16_t start = gb_address & 0x1fff;
+	for (uint16_t offset = start & ~0xf; offset < start + length; offset += 16) {
+		if (offset < 0x1800)
+			tileGeneration[bank][offset >> 4] = generation;
+		else
+			mapRowGeneration[bank][(offset - 0x1800) >> 5] = generation;
+	}
+}
+
+uint64_t Memory::getVramGeneration() {
+	return vramGeneration;
+}
+
+const uint64_t* Memory::getTileGenerations(int bank) {
+	return tileGeneration[bank];
+}
 
-	uint16_t src_addr = gb_mem[0xff46] << 8;
-	uint16_t dst_addr = 0xfe00;		//always OAM
-	for (int i = 0; i < 160; i++) {
-		write(dst_addr++, read(src_addr++));
+const uint64_t* Memory::getMapRowGenerations(int bank) {
+	return mapRowGeneration[bank];
+}
+
+uint64_t Memory::getOamGeneration() {
+	return oamGeneration;
+}
+
+//dma copy. Runs of bytes in plain memory pages are copied at once,
+//the rest goes through read and write one byte at a time
+void Memory::copyBlock(uint16_t dst_addr, uint16_t src_addr, int length) {
+
+	while (length > 0) {
+		int n = std::min({ length, 0x100 - (src_addr & 0xff), 0x100 - (dst_addr & 0xff) });
+		const uint8_t* src_page = readPages[src_addr >> 8];
+		uint8_t* dst_page = writePages[dst_addr >> 8];
+		const uint8_t* src = (src_page != nullptr) ? src_page + (src_addr & 0xff) : nullptr;
+		uint8_t* dst = (dst_page != nullptr) ? dst_page + (dst_addr & 0xff) : nullptr;
+
+		//overlapping runs are copied byte by byte, so the result is the same
+		if (src != nullptr && dst != nullptr && (dst + n <= src || src + n <= dst)) {
+			if (dst_addr >= 0x8000 && dst_addr <= 0x9fff) {		//vram
+				if (memcmp(dst, src, n) != 0) {
+					memcpy(dst, src, n);
+					markVram(dst_addr, n);
+				}
+			}
+			else if (dst_addr >= 0xfe00 && dst_addr <= 0xfe9f) {		//oam
+				if (memcmp(dst, src, n) != 0) {
+					memcpy(dst, src, n);
+					oamGeneration++;
+				}
+			}
+			else
+				memcpy(dst, src, n);
+			if (dst_addr >= 0xc000 && dst_addr <= 0xdfff) {		//wram can contain code
+				for (int i = 0; i < n; i++) {
+					_gameboy->invalidateCode(dst_addr + i);
+				}
+			}
+		}
+		else {
+			for (int i = 0; i < n; i++) {
+				write(dst_addr + i, read(src_addr + i));
+			}
+		}
+		src_addr += n;
+		dst_addr += n;
+		length -= n;
 	}
 }
 
+//copy the memory to oam region instantly
+void Memory::oam_dma_copy(void) {
+	copyBlock(0xfe00, gb_mem[0xff46] << 8, 160);		//always OAM
+}
+
 void Memory::activate_hdma(uint8_t screenEnable) {
 	
 	//H-BLANK tranfer mode
@@ -293,9 +563,7 @@ void Memory::activate_hdma(uint8_t screenEnable) {
 	}
 
 	//copy data
-	for (int i = 0; i < (io_map->HDMA.transf_length + 1) * 16; i++) {
-		write(dst_addr + i, read(src_addr + i));
-	}
+	copyBlock(dst_addr, src_addr, (io_map->HDMA.transf_length + 1) * 16);
 	io_map->HDMA.transf_length = 0x7f;
 	io_map->HDMA.transfer_mode = 1;	//transfer finished
 }
@@ -308,9 +576,9 @@ void Memory::transfer_hdma() {
 	uint16_t dst_addr = 0x8000 | ((((io_map->HDMA.HDMA4) | (io_map->HDMA.HDMA3 << 8)) & 0x1ff0));
 
 	//copy data
-	for (int i = 0; i < 16; i++) {
-		write(dst_addr++, read(src_addr++));
-	}
+	copyBlock(dst_addr, src_addr, 16);
+	src_addr += 16;
+	dst_addr += 16;
 
 	//update hdma registers
 	io_map->HDMA.HDMA2 = src_addr & 0xf0;
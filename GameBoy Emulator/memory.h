@@ -5,7 +5,10 @@
 #include "cartridge.h"
 
 #include <cstdint>
-#include <mutex>
+#include <atomic>
+
+//converts a cgb colour (5 bits per channel, red in the low bits) to the screen buffer format
+typedef uint32_t (*color_curve)(uint16_t color);
 
 class Memory {
 public:
@@ -20,12 +23,50 @@ public:
 	uint8_t* getVramBank1();
 	IO_map* getIOMap();
 	uint8_t* getOam();
-	void saveCartridgeState();
-	SDL_Color getBackgroundColor(int palette, int num);
-	const color_palette const* getBackgroundPalette();
-	SDL_Color getSpriteColor(int palette, int num);
+	void saveCartridgeState();		//the save is done by the emulation thread at the end of the frame
+	void handleSaveRequest();
+	//Palette colours in the screen buffer format, updated when the palette registers are written.
+	//cgb: 8 palettes of 4 colours. dmg: 0 is BGP, 1 is OBP0, 2 is OBP1
+	const uint32_t* getBackgroundColors();
+	const uint32_t* getSpriteColors();
+	const uint32_t* getDmgColors(int palette);
+	const uint8_t* getDmgShadeIndexes(int palette);		//shade numbers of the dmg palette colours
+	const uint32_t* getDmgShades();
+	void setDmgShades(const SDL_Color* shades);		//the 4 shades of the dmg screen
+	void setColorCurve(color_curve curve);
+	uint64_t getPaletteGeneration();		//changes when a palette colour table is updated
 	void transfer_hdma();
+	int32_t getRomOffset(uint16_t gb_address);
+	uint32_t getRomSize();
+	int getWramBank();
+	//vram change tracking. Every change gets a new generation, stored in the 16 byte tile
+	//(0x8000 - 0x97ff) or the 32 byte tile map row (0x9800 - 0x9fff) it belongs to.
+	//Writes that don't change the memory are not counted
+	uint64_t getVramGeneration();		//generation of the last change
+	const uint64_t* getTileGenerations(int bank);		//384 tiles
+	const uint64_t* getMapRowGenerations(int bank);		//64 rows, 32 per tile map
+	uint64_t getOamGeneration();		//changes when the oam is modified
 private:
+	//Host memory of each 256 byte page, nullptr when the access needs a handler (io, cartridge ram,
+	//mbc registers). Rebuilt when the bootstrap rom, a vram or wram bank or a cartridge bank is switched
+	uint8_t* readPages[256];
+	uint8_t* writePages[256];
+	void mapPages();
+	void mapCartridge();
+	void mapVram();
+	void mapWram();
+	void mapPage(int page, uint8_t* data, bool writable);
+
+	//read and write handlers, specialized for the dmg and the cgb and selected when the rom is loaded
+	template <bool cgb> uint8_t readModel(uint16_t gb_address);
+	template <bool cgb> void writeModel(uint16_t gb_address, uint8_t value);
+	uint8_t (Memory::*readFunc)(uint16_t gb_address);
+	void (Memory::*writeFunc)(uint16_t gb_address, uint8_t value);
+
+	void copyBlock(uint16_t dst_addr, uint16_t src_addr, int length);
+	void markVram(uint16_t gb_address, int length);
+	void updateCgbColor(const uint8_t* paletteMem, uint32_t* colors, int index);
+	void updateDmgColors(int palette);
 	bool load_bootrom();
 	void activate_hdma(uint8_t screenEnable);
 
@@ -34,11 +75,21 @@ private:
 	uint8_t gb_mem[0x10000];	//memory mapped by 16 bit register (65536 bytes)
 	uint8_t bg_palette_mem[64];	//8 background palettes with 4 colors per palette
 	uint8_t sprite_palette_mem[64];	//8 sprites palettes with 4 colors per palette
+	uint32_t bgColors[32], spriteColors[32];	//resolved palette memory
+	uint32_t dmgColors[3][4];		//resolved BGP, OBP0 and OBP1
+	uint8_t dmgShadeIndexes[3][4];
+	uint32_t dmgShades[4];
+	color_curve colorCurve;
+	uint64_t paletteGeneration;
 	uint8_t *wram_banks[7];		//wram banks, only in CGB mode
 
 	//In gbc mode all 2 banks of 0x2000 bytes of vram are used, 
 	//in dmg mode only the first bank. Mapped at: 0x8000 - 0x9fff
 	uint8_t **vram;
+	uint64_t vramGeneration;
+	uint64_t tileGeneration[2][384];
+	uint64_t mapRowGeneration[2][64];
+	uint64_t oamGeneration;
 
 	uint8_t* ext_ram;		//external bus for ram
 	uint8_t* wram;	//work ram (0xc000 - 0xdfff)
@@ -48,7 +99,15 @@ private:
 	uint8_t videoMode;
 	uint8_t hdma_active;
 
-	std::mutex cart_ram_AccessMutex;
+	std::atomic<bool> saveRequested;
 };
 
+//plain memory is a single load from the page table
+inline uint8_t Memory::read(uint16_t gb_address) {
+	const uint8_t* page = readPages[gb_address >> 8];
+	if (page != nullptr)
+		return page[gb_address & 0xff];
+	return (this->*readFunc)(gb_address);
+}
+
 #endif
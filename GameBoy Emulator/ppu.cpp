@@ -3,26 +3,62 @@
 #include "memory.h"
 #include "globals.h"
 #include "gameboy.h"
+#include "compositor.h"
 
-#include <mutex>
 #include <malloc.h>
+#include <climits>
+#include <algorithm>
+#ifdef GB_LINE_REUSE_VERIFY
+#include <iostream>
+#endif
 
 Ppu::Ppu() {
 	updatePalette = false;
+	frameSkip = 0;
+	skipCounter = 0;
+	skippingFrame = false;
+	framesSinceFetch = 0;
+	framesPerFetch = 1;
+	sink = &memorySink;
+	frameBuffer = nullptr;
+	rgbaOutput = true;
+	indexedSink = nullptr;
+	indexedBuffer = nullptr;
+	for (int i = 0; i < 64; i++) {
+		cgbIndexes[i] = i;
+	}
+	rgbaCopies.memory[LINE_COPY_SAVED] = (uint8_t*)savedColors;
+	rgbaCopies.pitch[LINE_COPY_SAVED] = sizeof(savedColors[0]);
+	indexedCopies.memory[LINE_COPY_SAVED] = (uint8_t*)savedIndexes;
+	indexedCopies.pitch[LINE_COPY_SAVED] = sizeof(savedIndexes[0]);
+	forgetLines();
+	lineStats = lastLineStats = {};
+	tileMapCacheEnabled = true;
 }
 
 void Ppu::Init() {
 
 	dmg_palette = gb_palettes[0];
+	_memory->setDmgShades(dmg_palette);
+	selectDrawBuffer();		//the model is known after the rom is loaded
+	compositeFunc = selectCompositor();
+	indexCompositeFunc = selectIndexCompositor();
 	vram[0] = _memory->getVramBank0();
 	vram[1] = _memory->getVramBank1();
 
-	for (int i = 0; i < 32; i++) {
-		color_lookup_table[i] = i * 8.2;
+	for (int bank = 0; bank < 2; bank++) {
+		for (int tile = 0; tile < 384; tile++) {
+			decodeTile(bank, tile);
+		}
+	}
+	tileCacheGeneration = _memory->getVramGeneration();
+	spriteIndexSize = 0;
+	forgetLines();
+	for (int map = 0; map < 2; map++) {
+		for (int data = 0; data < 2; data++) {
+			std::fill_n(tileMaps[map][data].rowGeneration, 32, TILE_ROW_NOT_RENDERED);
+		}
 	}
-
-	//used to provide a copy of the buffer to render to the renderer
-	tempBuffer = (uint32_t*)malloc(23040 * 4);
 }
 
 void Ppu::setPalette(int nr) {
@@ -30,46 +66,136 @@ void Ppu::setPalette(int nr) {
 	paletteNr = nr;
 }
 
-//simple bubble sort for x position
+void Ppu::setFrameSkip(int frames) {
+	frameSkip = frames;
+}
+
+//decide if the frame starting is drawn. The automatic setting skips the frames
+//emulated in excess of the ones the renderer shows, like with fast forward
+void Ppu::startFrame() {
+	int skip = frameSkip;
+	if (frameSkip == FRAMESKIP_AUTO)
+		skip = std::max(framesPerFetch - 1, 0);
+	skipCounter = (skipCounter >= skip) ? 0 : skipCounter + 1;
+	skippingFrame = (skipCounter != 0);
+}
+
+//stable insertion sort for x position. Sprites with the same x keep the oam order.
+//The oam is usually close to sorted, so few sprites are moved
 void Ppu::sort(sprite_attribute** buffer, int len) {
-	int i, j;
-	for (i = 0; i < len - 1; i++) {
-		for (j = 0; j < len - i - 1; j++) {
-			if (buffer[j]->x_pos > buffer[j + 1]->x_pos) {
-				sprite_attribute* temp = buffer[j];
-				buffer[j] = buffer[j + 1];
-				buffer[j + 1] = temp;
-			}
-		}
+	for (int i = 1; i < len; i++) {
+		sprite_attribute* sprite = buffer[i];
+		int j = i;
+		for (; j > 0 && buffer[j - 1]->x_pos > sprite->x_pos; j--)
+			buffer[j] = buffer[j - 1];
+		buffer[j] = sprite;
 	}
 }
 
 void Ppu::clearScanline(IO_map* io) {
-	uint32_t* buffer = screenBuffers[activeBuffer];
-
 	//clear the scanline
-	uint32_t* scanlineBuffer = &buffer[io->LY * 160];
+	uint32_t* scanlineBuffer = frameLine(io->LY);
 	for (int i = 0; i < 160; i++) {
 		memcpy(&scanlineBuffer[i], &dmg_palette[0], 4);
 	}
 }
 
+//the blank screen is shown as a new frame
 void Ppu::clearScreen() {
-	bufferMutex.lock();
-	if (_GBC_Mode) {
-		for (int i = 0; i < 160 * 144; i++) {
-			screenBuffers[0][i] = 0xffffffff;
-			screenBuffers[1][i] = 0xffffffff;
+	uint32_t color = 0xffffffff;
+	if (!_GBC_Mode)
+		memcpy(&color, &dmg_palette[0], 4);
+	for (int line = 0; line < 144; line++) {
+		if (rgbaOutput) {
+			uint32_t* scanlineBuffer = frameLine(line);
+			for (int i = 0; i < 160; i++) {
+				scanlineBuffer[i] = color;
+			}
 		}
-		bufferMutex.unlock();
-		return;
+		if (indexedSink != nullptr)
+			memset(indexedLine(line), _GBC_Mode ? INDEX_BLANK : 0, 160);
+	}
+	endFrame();
+	forgetLines();		//the blank frame replaced the lines in the sink buffers
+}
+
+//memory of a line of the frame being drawn. The frame starts in the sink with its first line
+uint32_t* Ppu::frameLine(int line) {
+	if (frameBuffer == nullptr) {
+		frameBuffer = sink->beginFrame(framePitch);
+		beginLineCopies(rgbaCopies, (uint8_t*)frameBuffer, framePitch * 4, sink->keepsFrames());
 	}
+	return frameBuffer + line * framePitch;
+}
 
-	for (int i = 0; i < 160 * 144; i++) {
-		memcpy(&screenBuffers[0][i], &dmg_palette[0], 4);
-		memcpy(&screenBuffers[1][i], &dmg_palette[0], 4);
+uint8_t* Ppu::indexedLine(int line) {
+	if (indexedBuffer == nullptr) {
+		indexedBuffer = indexedSink->beginIndexedFrame(indexedPitch);
+		beginLineCopies(indexedCopies, indexedBuffer, indexedPitch, indexedSink->keepsFrames());
+	}
+	return indexedBuffer + line * indexedPitch;
+}
+
+void Ppu::endFrame() {
+	if (frameBuffer != nullptr) {
+		sink->endFrame();
+		frameBuffer = nullptr;
+	}
+	if (indexedBuffer != nullptr) {
+		//the colours of the indexes at the end of the frame
+		uint32_t palette[INDEXED_PALETTE_SIZE] = {};
+		if (_GBC_Mode) {
+			memcpy(palette, _memory->getBackgroundColors(), 32 * 4);
+			memcpy(&palette[INDEX_SPRITE], _memory->getSpriteColors(), 32 * 4);
+			palette[INDEX_BLANK] = 0xffffffff;
+		}
+		else {
+			memcpy(palette, _memory->getDmgShades(), 4 * 4);
+			palette[INDEX_BLANK] = palette[0];
+		}
+		indexedSink->endIndexedFrame(palette);
+		indexedBuffer = nullptr;
 	}
-	bufferMutex.unlock();
+}
+
+//the copies of the lines belong to the old sinks and to the outputs enabled when the lines were drawn
+void Ppu::setFrameSink(FrameSink* frameSink) {
+	endFrame();
+	sink = (frameSink != nullptr) ? frameSink : &memorySink;
+	forgetLines();
+}
+
+void Ppu::setIndexedFrameSink(IndexedFrameSink* sink) {
+	endFrame();
+	indexedSink = sink;
+	selectDrawBuffer();
+	forgetLines();
+}
+
+void Ppu::setRgbaOutput(bool enabled) {
+	endFrame();
+	rgbaOutput = enabled;
+	selectDrawBuffer();
+	forgetLines();
+}
+
+void Ppu::setTileMapCache(bool enabled) {
+	tileMapCacheEnabled = enabled;
+}
+
+line_reuse_stats Ppu::getLineReuseStats() {
+	return lastLineStats;
+}
+
+void Ppu::selectDrawBuffer() {
+	static void (Ppu::* const drawBufferFuncs[2][4])(IO_map* io) = {
+		{ &Ppu::drawBuffer<false, 0>, &Ppu::drawBuffer<false, LAYER_RGBA>,
+			&Ppu::drawBuffer<false, LAYER_INDEX>, &Ppu::drawBuffer<false, LAYER_RGBA | LAYER_INDEX> },
+		{ &Ppu::drawBuffer<true, 0>, &Ppu::drawBuffer<true, LAYER_RGBA>,
+			&Ppu::drawBuffer<true, LAYER_INDEX>, &Ppu::drawBuffer<true, LAYER_RGBA | LAYER_INDEX> }
+	};
+	int output = (rgbaOutput ? LAYER_RGBA : 0) | ((indexedSink != nullptr) ? LAYER_INDEX : 0);
+	drawBufferFunc = drawBufferFuncs[_GBC_Mode ? 1 : 0][output];
 }
 
 void Ppu::disable() {
@@ -84,6 +210,25 @@ void Ppu::enable() {
 	registers.enabled = 1;
 }
 
+//clock cycles before the next change of line or mode. 
+//Running the ppu for less cycles only updates the scanline counter
+int Ppu::cyclesToNextEvent() {
+	IO_map* io = _memory->getIOMap();
+
+	if (!(io->LCDC & 0x80))		//lcd disabled
+		return registers.enabled ? 0 : INT_MAX;
+	if (!registers.enabled)
+		return 0;
+
+	if (io->LY < 144) {
+		if (registers.sl_cnt <= 204)
+			return 205 - registers.sl_cnt;		//mode 2
+		if (registers.sl_cnt <= 284)
+			return 285 - registers.sl_cnt;		//mode 3
+	}
+	return 457 - registers.sl_cnt;		//next line
+}
+
 void Ppu::drawScanline(int clk_cycles){
 	IO_map* io = _memory->getIOMap();
 	uint8_t* oam = _memory->getOam();
@@ -112,9 +257,12 @@ void Ppu::drawScanline(int clk_cycles){
 		}
 		if (io->LY >= 154) {
 			io->LY = 0;
-			bufferMutex.lock();
-			activeBuffer = !activeBuffer;
-			bufferMutex.unlock();
+			endFrame();
+			framesSinceFetch++;
+			if (!skippingFrame)
+				lastLineStats = lineStats;
+			lineStats = {};
+			startFrame();
 		}
 	}
 	
@@ -132,14 +280,14 @@ void Ppu::drawScanline(int clk_cycles){
 		//MODE 2 - scan OAM to find which OBJs are active. During this time OAM is locked.
 		else if (registers.sl_cnt <= 284) {
 			stat->lcd_mode = 2;
-			if (!registers.spritesLoaded) {		//search sprites in oam
+			if (!registers.spritesLoaded && !skippingFrame) {		//search sprites in oam
 				findScanlineSprites((sprite_attribute*)oam, io);
 			}
 		}
 		else {
 			stat->lcd_mode = 3;		//MODE 3 (HDraw) - drawing the pixels. No OAM and vram access outside
-			if (registers.bufferDrawn == 0) {
-				drawBuffer(io);
+			if (registers.bufferDrawn == 0 && !skippingFrame) {
+				(this->*drawBufferFunc)(io);
 				registers.bufferDrawn = 1;
 			}
 		}
@@ -175,81 +323,74 @@ void Ppu::drawScanline(int clk_cycles){
 
 }
 
-std::pair <bool, int> Ppu::createWindowScanline(priority_pixel* windowScanline, IO_map* io) {
+template <bool cgb, int output>
+std::pair <bool, int> Ppu::createWindowScanline(scanline_layer& windowScanline, IO_map* io) {
 
-	if (!(io->LCDC & 0x20) || (_GBC_Mode && !(io->LCDC & 0x1))) {		//window disabled
+	if (!(io->LCDC & 0x20) || (cgb && !(io->LCDC & 0x1))) {		//window disabled
 		return std::pair <bool, int> (false, 0);
 	}
 	if (io->LY < io->WY || io->WX > 166) {		//not shown
 		return std::pair <bool, int>(false, 0);
 	}
 
-	for (int i = 0; i < 160; i++) {
-		windowScanline[i].trasparent = 1;
-	}
+	memset(windowScanline.trasparent, 0xff, 160);
 
 	background_attribute bg_att = {};
-
-	//create the background palette table
-	const color_palette const* pixelGBCPalette = _memory->getBackgroundPalette();
-	SDL_Color pixel_palette[32];
-	if (_GBC_Mode) {
-		for (int i = 0; i < 32; i++) {
-			pixel_palette[i] = { color_lookup_table[pixelGBCPalette[i].red],
-				color_lookup_table[pixelGBCPalette[i].green],
-				color_lookup_table[pixelGBCPalette[i].blue],
-				255 };
-		}
-	}
+	const uint32_t* colors = cgb ? _memory->getBackgroundColors() : _memory->getDmgColors(0);
+	const uint8_t* indexes = cgb ? cgbIndexes : _memory->getDmgShadeIndexes(0);
 
 	//memory section for window tile map
 	uint32_t tileMapAddr = ((io->LCDC & 0x40) ? 0x1c00 : 0x1800);
 
+	uint8_t startingPixel = std::max(io->WX - 7, 0);
+	if (tileMapCacheEnabled) {
+		const uint8_t* mapLine = tileMapLine<cgb>((io->LCDC & 0x40) ? 1 : 0, io->LY - io->WY, io);
+		for (int screenX = startingPixel; screenX < 160; screenX++) {
+			uint8_t pixel = mapLine[screenX - io->WX + 7];
+			windowScanline.trasparent[screenX] = (pixel & 0x3) ? 0 : 0xff;
+			if constexpr ((output & LAYER_RGBA) != 0) windowScanline.color[screenX] = colors[pixel & 0x1f];
+			if constexpr ((output & LAYER_INDEX) != 0) windowScanline.index[screenX] = indexes[pixel & 0x1f];
+		}
+		return std::pair <bool, int>(true, startingPixel);
+	}
+
 	uint8_t pixelRow = (io->LY - io->WY) % 8;
 	uint8_t mapRow = (io->LY - io->WY) / 8;
-	uint8_t startingPixel = std::max(io->WX - 7, 0);
+	const uint8_t* tileRowColors = nullptr;
 	for (uint8_t screenX = startingPixel; screenX < 160; screenX++) {
 		uint8_t tileMapX = screenX - io->WX + 7;
-		short tileNum;
-		if (io->LCDC & 0x10) {		//4th bit in LCDC: tiles counting methods
-			tileNum = vram[0][tileMapAddr + mapRow * 32 + tileMapX / 8];
-		}
-		else {
-			tileNum = (char)vram[0][tileMapAddr + mapRow * 32 + tileMapX / 8] + 256;
-		}
-		//get the background tile attribute (only in gbc mode)
-		if (_GBC_Mode) memcpy((void*)&bg_att, &vram[1][tileMapAddr + mapRow * 32 + tileMapX / 8], 1);
-
-		//get the pointer to the tile memory
-		uint8_t* tileMem = &vram[bg_att.vram_bank][tileNum * 16];
-
-		//find out the color
 		int col = tileMapX % 8;
-		uint8_t color_nr = ((tileMem[pixelRow * 2] >> (7 - col)) & 0x1) |
-			(((tileMem[pixelRow * 2 + 1] >> (7 - col)) << 1) & 0x2);
-		windowScanline[screenX].trasparent = (color_nr == 0);
 
-		if (_GBC_Mode) {
-			//draw the pixel
-			memcpy(&windowScanline[screenX].color, &pixel_palette[bg_att.bg_palette*4 + color_nr], 4);
-			continue;
+		if (tileRowColors == nullptr || col == 0) {		//next tile
+			short tileNum;
+			if (io->LCDC & 0x10) {		//4th bit in LCDC: tiles counting methods
+				tileNum = vram[0][tileMapAddr + mapRow * 32 + tileMapX / 8];
+			}
+			else {
+				tileNum = (char)vram[0][tileMapAddr + mapRow * 32 + tileMapX / 8] + 256;
+			}
+			//get the background tile attribute (only in gbc mode)
+			if constexpr (cgb) memcpy((void*)&bg_att, &vram[1][tileMapAddr + mapRow * 32 + tileMapX / 8], 1);
+			tileRowColors = tileRow(bg_att.vram_bank, tileNum, pixelRow, bg_att.h_flip, bg_att.v_flip);
 		}
 
-		uint8_t color = (io->BGP >> (color_nr * 2)) & 0x3;
-		SDL_Color pixel = dmg_palette[color];
+		//find out the color
+		uint8_t color_nr = tileRowColors[col];
+		windowScanline.trasparent[screenX] = (color_nr == 0) ? 0xff : 0;
 
 		//draw the pixel
-		memcpy(&windowScanline[screenX].color, &pixel, 4);
+		if constexpr ((output & LAYER_RGBA) != 0) windowScanline.color[screenX] = colors[bg_att.bg_palette * 4 + color_nr];
+		if constexpr ((output & LAYER_INDEX) != 0) windowScanline.index[screenX] = indexes[bg_att.bg_palette * 4 + color_nr];
 	}
 	return std::pair <bool, int>(true, startingPixel);
 }
 
-void Ppu::createSpriteScanline(priority_pixel* scanline, IO_map* io) {
+template <bool cgb, int output>
+void Ppu::createSpriteScanline(scanline_layer& scanline, IO_map* io) {
 
 	//initialize the scanline as transparent
-	for (int i = 0; i < 160; i++) {
-		scanline[i].trasparent = 1;
-	}
+	memset(scanline.trasparent, 0xff, 160);
+	memset(scanline.priority, 0, 160);
 	if (!(io->LCDC & 0x2))		//sprites are disabled
 		return;
 
@@ -257,10 +398,11 @@ void Ppu::createSpriteScanline(priority_pixel* scanline, IO_map* io) {
 	for (int i = 9; i >= 0; i--) {
 		if (registers.scanlineSprites[i] == nullptr)
 			continue;
-		drawSprite(registers.scanlineSprites[i], io, scanline);
+		drawSprite<cgb, output>(registers.scanlineSprites[i], io, scanline);
 	}
 }
 
+template <bool cgb>
 void Ppu::findScanlineBgTiles(IO_map* io) {
 	
 	short y = (io->SCY + io->LY) % 256;
@@ -288,15 +430,11 @@ void Ppu::findScanlineBgTiles(IO_map* io) {
 
 		//get tile attributes
 		background_attribute tile_attr = {};
-		if (_GBC_Mode) memcpy((void*)&tile_attr, &vram[1][tileMapAddr + firstTileGridY * 32 + tileGridX], 1);
+		if constexpr (cgb) memcpy((void*)&tile_attr, &vram[1][tileMapAddr + firstTileGridY * 32 + tileGridX], 1);
 
-		//get the pointer to the tile memory
-		uint8_t* tileMem = &vram[tile_attr.vram_bank][tileNum * 16];
-
-		//copy the tile memory and the attributes to the registers
+		//store the decoded row and the attributes in the registers
 		registers.backgroundTiles[i].tile_attr = tile_attr;
-		memcpy(registers.backgroundTiles[i].tile_mem, tileMem, 16);
-		flipTile(registers.backgroundTiles[i]);
+		registers.backgroundTiles[i].row = tileRow(tile_attr.vram_bank, tileNum, firstTilePixelY, tile_attr.h_flip, tile_attr.v_flip);
 	}
 
 	//set the position of the first tile on screen
@@ -306,154 +444,385 @@ void Ppu::findScanlineBgTiles(IO_map* io) {
 
 void Ppu::findScanlineSprites(sprite_attribute* oam, IO_map* io) {
 
-	sprite_attribute* sprites[40];
+	//called once per line, so the index is rebuilt at most once per line, on the first line after a change
+	int spriteSize = ((io->LCDC & 0x4) ? 16 : 8);
+	if (spriteSize != spriteIndexSize || _memory->getOamGeneration() != spriteIndexGeneration)
+		buildSpriteIndex(oam, io);
+
 	memset(registers.scanlineSprites, 0, sizeof(registers.scanlineSprites));
+	memcpy(registers.scanlineSprites, lineSprites[io->LY], lineSpriteCount[io->LY] * sizeof(sprite_attribute*));
+	registers.spritesLoaded = 1;
+}
+
+//assign the sprites to the lines they cover, in priority order
+void Ppu::buildSpriteIndex(sprite_attribute* oam, IO_map* io) {
+
+	sprite_attribute* sprites[40];
 	for (int i = 0; i < 40; i++) sprites[i] = &oam[i];
 	if (!_GBC_Mode) sort(sprites, 40);
 	int spriteSize = ((io->LCDC & 0x4) ? 16 : 8);
-	int j = 0;
+
+	memset(lineSpriteCount, 0, sizeof(lineSpriteCount));
 	for (int i = 0; i < 40; i++) {
 		int yPos = sprites[i]->y_pos - 16;
-		if (io->LY >= yPos &&
-			(io->LY < yPos + spriteSize)) {
-			registers.scanlineSprites[j++] = sprites[i];
-			if (j >= 10)	//max 10 sprites per scanline
-				break;
+		for (int line = std::max(yPos, 0); line < std::min(yPos + spriteSize, 144); line++) {
+			if (lineSpriteCount[line] < 10)		//max 10 sprites per scanline
+				lineSprites[line][lineSpriteCount[line]++] = sprites[i];
 		}
 	}
-	registers.spritesLoaded = 1;
+	spriteIndexGeneration = _memory->getOamGeneration();
+	spriteIndexSize = spriteSize;
 }
 
+template <bool cgb, int output>
 void Ppu::drawBuffer(IO_map* io) {
-	uint32_t* buffer = screenBuffers[activeBuffer];
 
-	//clear the scanline
-	uint32_t* scanlineBuffer = &buffer[io->LY * 160];
-	if (!_GBC_Mode) {
-		for (int i = 0; i < 160; i++) {
-			memcpy(&scanlineBuffer[i], &dmg_palette[io->BGP & 0x3], 4);
+	//the palette chosen in the menu is applied by the emulation thread, which owns the palette tables
+	if (updatePalette) {
+		updatePalette = 0;
+		if (paletteNr >= 0 && paletteNr < 3) {
+			dmg_palette = gb_palettes[paletteNr];
+			_memory->setDmgShades(dmg_palette);
 		}
 	}
-	else {
-		for (int i = 0; i < 160; i++) {
-			scanlineBuffer[i] = 0xffffffff;
-		}
+
+	//a line with the same inputs is taken from the copies, and drawn only if an output has none
+	int line = io->LY;
+	lineStats.drawn++;
+	bool unchanged = reuseLine<cgb>(io);
+	bool reused = unchanged;
+	if (unchanged) {
+		if constexpr ((output & LAYER_RGBA) != 0)
+			reused &= reuseLineCopy(rgbaCopies, (uint8_t*)frameLine(line), line, sizeof(savedColors[0]));
+		if constexpr ((output & LAYER_INDEX) != 0)
+			reused &= reuseLineCopy(indexedCopies, indexedLine(line), line, sizeof(savedIndexes[0]));
+	}
+	if (reused) {
+		lineStats.reused++;
+#ifndef GB_LINE_REUSE_VERIFY
+		return;
+#endif
 	}
-	priority_pixel spriteScanline[160], bgScanline[160], windowScanline[160];
+#ifdef GB_LINE_REUSE_VERIFY
+	uint32_t reusedColors[160];
+	if constexpr ((output & LAYER_RGBA) != 0)
+		memcpy(reusedColors, frameLine(line), sizeof(reusedColors));
+#endif
+	refreshTileCache();
+
+	scanline_layer spriteScanline, bgScanline, windowScanline;
 
 	//create scanline buffers
-	createBackgroundScanline(bgScanline, io);
-	std::pair <bool, int> windowStatus = createWindowScanline(windowScanline, io);
-	createSpriteScanline(spriteScanline, io);
+	createBackgroundScanline<cgb, output>(bgScanline, io);
+	std::pair <bool, int> windowStatus = createWindowScanline<cgb, output>(windowScanline, io);
+	createSpriteScanline<cgb, output>(spriteScanline, io);
+
+	//every pixel is written by the compositor, so the scanline isn't cleared
+	int windowStart = windowStatus.first ? windowStatus.second : 160;
+	if constexpr ((output & LAYER_RGBA) != 0) {
+		uint32_t* scanline = frameLine(line);
+		compositeFunc(scanline, bgScanline, windowScanline, spriteScanline, windowStart);
+		lineCopyDrawn(rgbaCopies, (uint8_t*)scanline, line, sizeof(savedColors[0]), unchanged);
+#ifdef GB_LINE_REUSE_VERIFY
+		if (reused && memcmp(reusedColors, scanline, sizeof(reusedColors)))
+			std::cout << "Reused line " << line << " differs from the drawn one" << std::endl;
+#endif
+	}
+	if constexpr ((output & LAYER_INDEX) != 0) {
+		uint8_t* scanline = indexedLine(line);
+		indexCompositeFunc(scanline, bgScanline, windowScanline, spriteScanline, windowStart);
+		lineCopyDrawn(indexedCopies, scanline, line, sizeof(savedIndexes[0]), unchanged);
+	}
+}
 
-	for (int i = 0; i < 160; i++) {
+//true when the inputs of the line are the same as the last time it was drawn, otherwise they are saved
+template <bool cgb>
+bool Ppu::reuseLine(IO_map* io) {
+
+	line_key key;
+	memset(&key, 0, sizeof(key));		//the padding is compared too
+	key.paletteGeneration = _memory->getPaletteGeneration();
+	key.LCDC = io->LCDC;
+	key.SCX = io->SCX;
+	key.SCY = io->SCY;
+	key.WX = io->WX;
+	key.WY = io->WY;
+	while (key.spriteCount < 10 && registers.scanlineSprites[key.spriteCount] != nullptr) {
+		key.sprites[key.spriteCount] = *registers.scanlineSprites[key.spriteCount];
+		key.spriteCount++;
+	}
+
+	int line = io->LY;
+	uint64_t generation = _memory->getVramGeneration();
+	if (lineCached[line] && !memcmp(&key, &lineKeys[line], sizeof(key))) {
+		//the used vram is checked only when there are changes since the line was drawn
+		if (generation == lineDrawGeneration[line] || lineVramGeneration<cgb>(io) <= lineDrawGeneration[line])
+			return true;
+	}
+	memcpy(&lineKeys[line], &key, sizeof(key));
+	lineDrawGeneration[line] = generation;
+	lineCached[line] = true;
+	return false;
+}
 
-		if (spriteScanline[i].trasparent) {
-			scanlineBuffer[i] = bgScanline[i].color;
-			//window pixels
-			if (windowStatus.first & (i >= windowStatus.second)) {
-				scanlineBuffer[i] = windowScanline[i].color;
-			}
-			continue;
+//newest vram generation among the tile map rows and the tiles used by the line
+template <bool cgb>
+uint64_t Ppu::lineVramGeneration(IO_map* io) {
+
+	uint64_t generation = 0;
+	if (io->LCDC & 0x1) {		//background
+		short y = (io->SCY + io->LY) % 256;
+		generation = tileMapRowGeneration<cgb>((io->LCDC & 0x8) ? 0x1c00 : 0x1800, y / 8, io->SCX / 8, 21, io);
+	}
+	if ((io->LCDC & 0x20) && (!cgb || (io->LCDC & 0x1)) && io->LY >= io->WY && io->WX <= 166) {		//window
+		int startingPixel = std::max(io->WX - 7, 0);
+		int firstColumn = (startingPixel - io->WX + 7) / 8;
+		int lastColumn = (159 - io->WX + 7) / 8;
+		generation = std::max(generation, tileMapRowGeneration<cgb>((io->LCDC & 0x40) ? 0x1c00 : 0x1800,
+			(io->LY - io->WY) / 8, firstColumn, lastColumn - firstColumn + 1, io));
+	}
+	if (io->LCDC & 0x2) {		//sprites
+		int spriteSize = (io->LCDC & 0x4) ? 16 : 8;
+		uint8_t tileMask = (io->LCDC & 0x4) ? 0xfe : 0xff;
+		for (int i = 0; i < 10 && registers.scanlineSprites[i] != nullptr; i++) {
+			sprite_attribute* sprite = registers.scanlineSprites[i];
+			int row = io->LY - (sprite->y_pos - 16);
+			if (row < 0 || row >= spriteSize)		//not drawn
+				continue;
+			row = sprite->y_flip ? (spriteSize - 1 - row) : row;
+			int bank = cgb && sprite->vram_bank;
+			generation = std::max(generation, _memory->getTileGenerations(bank)[(sprite->tile & tileMask) + row / 8]);
 		}
+	}
+	return generation;
+}
 
-		//if background has priority, the transparency is considered
-		if ((bgScanline[i].priority | spriteScanline[i].priority)) {
+//newest generation of a tile map row, of its attributes and of the tiles in the columns used
+template <bool cgb>
+uint64_t Ppu::tileMapRowGeneration(uint32_t tileMapAddr, int mapRow, int firstColumn, int columns, IO_map* io) {
 
-			scanlineBuffer[i] = spriteScanline[i].color;
+	int row = (tileMapAddr - 0x1800) / 32 + mapRow;
+	uint64_t generation = _memory->getMapRowGenerations(0)[row];
+	if constexpr (cgb) generation = std::max(generation, _memory->getMapRowGenerations(1)[row]);
 
-			if(!bgScanline[i].trasparent)
-				scanlineBuffer[i] = bgScanline[i].color;
+	for (int i = 0; i < columns; i++) {
+		uint32_t addr = tileMapAddr + mapRow * 32 + (firstColumn + i) % 32;
+		short tileNum;
+		if (io->LCDC & 0x10) {		//4th bit in LCDC: tiles counting methods
+			tileNum = vram[0][addr];
+		}
+		else {
+			tileNum = (char)vram[0][addr] + 256;
+		}
+		background_attribute attr = {};
+		if constexpr (cgb) memcpy((void*)&attr, &vram[1][addr], 1);
+		generation = std::max(generation, _memory->getTileGenerations(attr.vram_bank)[tileNum]);
+	}
+	return generation;
+}
 
-			//window pixels
-			if (windowStatus.first & (i >= windowStatus.second) & !windowScanline[i].trasparent) {
-				scanlineBuffer[i] = windowScanline[i].color;
-			}
-			continue;
+//the lines are drawn again and the sink buffers are tracked from the next frame
+void Ppu::forgetLines() {
+	memset(lineCached, 0, sizeof(lineCached));
+	for (line_copies* copies : { &rgbaCopies, &indexedCopies }) {
+		memset(copies->memory, 0, LINE_COPY_BUFFERS * sizeof(copies->memory[0]));
+		memset(copies->valid, 0, sizeof(copies->valid));
+		copies->current = -1;
+		copies->nextBuffer = 0;
+	}
+}
+
+//find the buffer of a new frame among the tracked ones
+void Ppu::beginLineCopies(line_copies& copies, uint8_t* memory, int pitch, bool keepsFrames) {
+	copies.current = -1;
+	if (!keepsFrames)
+		return;
+	for (int i = 0; i < LINE_COPY_BUFFERS; i++) {
+		if (copies.memory[i] == memory && copies.pitch[i] == pitch) {
+			copies.current = i;
+			return;
 		}
+	}
 
-		//draw sprite
-		scanlineBuffer[i] = spriteScanline[i].color;
+	//a buffer not seen before replaces the one tracked for the longest time
+	int buffer = copies.nextBuffer;
+	copies.nextBuffer = (buffer + 1) % LINE_COPY_BUFFERS;
+	copies.memory[buffer] = memory;
+	copies.pitch[buffer] = pitch;
+	for (int line = 0; line < 144; line++) {
+		copies.valid[line] &= ~(1 << buffer);
+	}
+	copies.current = buffer;
+}
 
+//put the last drawn content of an unchanged line in the frame. Nothing is written if the frame
+//buffer still has it. False when there is no copy of the line
+bool Ppu::reuseLineCopy(line_copies& copies, uint8_t* line, int lineNr, int size) {
+	if (copies.current >= 0 && (copies.valid[lineNr] & (1 << copies.current)))
+		return true;
+	for (int i = 0; i <= LINE_COPY_SAVED; i++) {
+		if (copies.valid[lineNr] & (1 << i)) {
+			memcpy(line, copies.memory[i] + lineNr * copies.pitch[i], size);
+			if (copies.current >= 0)
+				copies.valid[lineNr] |= 1 << copies.current;
+			return true;
+		}
+	}
+	return false;
+}
+
+//a line drawn with new content replaces the copies. A line drawn again unchanged is saved
+//by the ppu when the sink doesn't keep its frames, so the next frames copy it
+void Ppu::lineCopyDrawn(line_copies& copies, uint8_t* line, int lineNr, int size, bool unchanged) {
+	uint8_t buffer = (copies.current >= 0) ? (1 << copies.current) : 0;
+	if (!unchanged) {
+		copies.valid[lineNr] = buffer;
+		return;
+	}
+	copies.valid[lineNr] |= buffer;
+	if (copies.current < 0 && !(copies.valid[lineNr] & (1 << LINE_COPY_SAVED))) {
+		memcpy(copies.memory[LINE_COPY_SAVED] + lineNr * copies.pitch[LINE_COPY_SAVED], line, size);
+		copies.valid[lineNr] |= 1 << LINE_COPY_SAVED;
 	}
-	
 }
 
-void Ppu::createBackgroundScanline(priority_pixel* scanline, IO_map*io) {
+template <bool cgb, int output>
+void Ppu::createBackgroundScanline(scanline_layer& scanline, IO_map*io) {
 	if (!(io->LCDC & 0x1)) {		//background/window disabled
-		//set background layer transparent
-		for (int i = 0; i < 160; i++) {
-			scanline[i].trasparent = 1;
+		//set background layer transparent, with the color of a cleared scanline
+		if constexpr ((output & LAYER_RGBA) != 0) {
+			uint32_t clearColor = cgb ? 0xffffffff : _memory->getDmgColors(0)[0];
+			for (int i = 0; i < 160; i++) {
+				scanline.color[i] = clearColor;
+			}
 		}
+		if constexpr ((output & LAYER_INDEX) != 0)
+			memset(scanline.index, cgb ? INDEX_BLANK : _memory->getDmgShadeIndexes(0)[0], 160);
+		memset(scanline.trasparent, 0xff, 160);
+		memset(scanline.priority, 0, 160);
 		return;
 	}
 
-	findScanlineBgTiles(io);
-
-	//create the background palette table
-	const color_palette const* pixelGBCPalette = _memory->getBackgroundPalette();
-	SDL_Color pixel_palette[32];
-	if (_GBC_Mode) {
-		for (int i = 0; i < 32; i++) {
-			pixel_palette[i] = { color_lookup_table[pixelGBCPalette[i].red],
-				color_lookup_table[pixelGBCPalette[i].green],
-				color_lookup_table[pixelGBCPalette[i].blue],
-				255 };
+	const uint32_t* colors = cgb ? _memory->getBackgroundColors() : _memory->getDmgColors(0);
+	const uint8_t* indexes = cgb ? cgbIndexes : _memory->getDmgShadeIndexes(0);
+	if (tileMapCacheEnabled) {
+		//the visible part of the map line, wrapping around
+		const uint8_t* mapLine = tileMapLine<cgb>((io->LCDC & 0x8) ? 1 : 0, (io->SCY + io->LY) % 256, io);
+		for (int i = 0; i < 160; i++) {
+			uint8_t pixel = mapLine[(io->SCX + i) % 256];
+			scanline.trasparent[i] = (pixel & 0x3) ? 0 : 0xff;
+			scanline.priority[i] = (pixel & 0x80) ? 0xff : 0;
+			if constexpr ((output & LAYER_RGBA) != 0) scanline.color[i] = colors[pixel & 0x1f];
+			if constexpr ((output & LAYER_INDEX) != 0) scanline.index[i] = indexes[pixel & 0x1f];
 		}
+		return;
 	}
 
+	findScanlineBgTiles<cgb>(io);
+
 	for (int i = 0; i < 160; i++) {
 		uint8_t bgIndex = (registers.firstBgTilePixelX + i) / 8;
 		background_tile& bgTile = registers.backgroundTiles[bgIndex];
 
-		int row = registers.firstBgTilePixelY;
-		int col = (registers.firstBgTilePixelX + i) % 8;
-		uint8_t color_nr = ((bgTile.tile_mem[row * 2] >> (7 - col)) & 0x1) |
-			(((bgTile.tile_mem[row * 2 + 1] >> (7 - col)) << 1) & 0x2);
-		scanline[i].trasparent = (color_nr == 0);		//transparent
-		scanline[i].priority = bgTile.tile_attr.bg_oam_priority;
-
-		if (_GBC_Mode) {
-
-			//draw the pixel
-			memcpy(&scanline[i].color, &pixel_palette[bgTile.tile_attr.bg_palette * 4 + color_nr], 4);
-			continue;
-		}
-
-		uint8_t color = (io->BGP >> (color_nr * 2)) & 0x3;
-		SDL_Color pixel = dmg_palette[color];
+		uint8_t color_nr = bgTile.row[(registers.firstBgTilePixelX + i) % 8];
+		scanline.trasparent[i] = (color_nr == 0) ? 0xff : 0;		//transparent
+		scanline.priority[i] = bgTile.tile_attr.bg_oam_priority ? 0xff : 0;
 
 		//draw the pixel
-		memcpy(&scanline[i], &pixel, 4);
+		if constexpr ((output & LAYER_RGBA) != 0) scanline.color[i] = colors[bgTile.tile_attr.bg_palette * 4 + color_nr];
+		if constexpr ((output & LAYER_INDEX) != 0) scanline.index[i] = indexes[bgTile.tile_attr.bg_palette * 4 + color_nr];
 	}
 
 }
 
 
-uint8_t Ppu::reverse(uint8_t n) {
-	// Reverse the top and bottom nibble then swap them.
-	return (reverse_lookup[n & 0b1111] << 4) | reverse_lookup[n >> 4];
+//rebuild the tiles changed since the last refresh
+void Ppu::refreshTileCache() {
+
+	uint64_t generation = _memory->getVramGeneration();
+	if (generation == tileCacheGeneration)
+		return;
+
+	for (int bank = 0; bank < 2; bank++) {
+		const uint64_t* tileGeneration = _memory->getTileGenerations(bank);
+		for (int tile = 0; tile < 384; tile++) {
+			if (tileGeneration[tile] > tileCacheGeneration)
+				decodeTile(bank, tile);
+		}
+	}
+	tileCacheGeneration = generation;
 }
 
-void Ppu::flipTile(background_tile& tile) {
-	if (tile.tile_attr.h_flip) {
-		for (int i = 0; i < 16; i++) {
-			tile.tile_mem[i] = reverse(tile.tile_mem[i]);
+void Ppu::decodeTile(int bank, int tile) {
+
+	const uint8_t* tileMem = &vram[bank][tile * 16];
+	uint8_t* normal = decodedTiles[bank][tile][0];
+	uint8_t* mirrored = decodedTiles[bank][tile][1];
+	for (int row = 0; row < 8; row++) {
+		for (int col = 0; col < 8; col++) {
+			uint8_t color_nr = ((tileMem[row * 2] >> (7 - col)) & 0x1) |
+				(((tileMem[row * 2 + 1] >> (7 - col)) << 1) & 0x2);
+			normal[row * 8 + col] = color_nr;
+			mirrored[row * 8 + 7 - col] = color_nr;
 		}
 	}
-	if (tile.tile_attr.v_flip) {
-		for (int i = 0; i < 4; i++) {
-			uint16_t t = ((uint16_t*)tile.tile_mem)[i];
-			((uint16_t*)tile.tile_mem)[i] = ((uint16_t*)tile.tile_mem)[7 - i];
-			((uint16_t*)tile.tile_mem)[7 - i] = t;
+}
+
+//line y of a rendered tile map, with the tile data selected in the LCDC.
+//The tile row is rendered again if the vram changed since the last time
+template <bool cgb>
+const uint8_t* Ppu::tileMapLine(int map, int y, IO_map* io) {
+	tile_map_cache& cache = tileMaps[map][(io->LCDC & 0x10) ? 1 : 0];
+	if (cache.rowGeneration[y / 8] != _memory->getVramGeneration())
+		renderTileMapRow<cgb>(cache, map, y / 8, io);
+	return cache.pixels[y];
+}
+
+//renders the tiles of a map row that changed, or all of them if the map row changed
+template <bool cgb>
+void Ppu::renderTileMapRow(tile_map_cache& cache, int map, int row, IO_map* io) {
+
+	uint32_t tileMapAddr = map ? 0x1c00 : 0x1800;
+	uint64_t rendered = cache.rowGeneration[row];
+	bool allTiles = rendered == TILE_ROW_NOT_RENDERED || _memory->getMapRowGenerations(0)[map * 32 + row] > rendered;
+	if constexpr (cgb) allTiles = allTiles || _memory->getMapRowGenerations(1)[map * 32 + row] > rendered;
+
+	for (int col = 0; col < 32; col++) {
+		uint32_t addr = tileMapAddr + row * 32 + col;
+		short tileNum;
+		if (io->LCDC & 0x10) {		//4th bit in LCDC: tiles counting methods
+			tileNum = vram[0][addr];
+		}
+		else {
+			tileNum = (char)vram[0][addr] + 256;
+		}
+		background_attribute attr = {};
+		if constexpr (cgb) memcpy((void*)&attr, &vram[1][addr], 1);
+		if (!allTiles && _memory->getTileGenerations(attr.vram_bank)[tileNum] <= rendered)
+			continue;
+
+		uint8_t attributes = (attr.bg_palette << 2) | (attr.bg_oam_priority ? 0x80 : 0);
+		for (int tileY = 0; tileY < 8; tileY++) {
+			const uint8_t* colorNumbers = tileRow(attr.vram_bank, tileNum, tileY, attr.h_flip, attr.v_flip);
+			uint8_t* pixels = &cache.pixels[row * 8 + tileY][col * 8];
+			for (int x = 0; x < 8; x++) {
+				pixels[x] = colorNumbers[x] | attributes;
+			}
 		}
 	}
+	cache.rowGeneration[row] = _memory->getVramGeneration();
+}
+
+//8 colour numbers of a tile row
+const uint8_t* Ppu::tileRow(int bank, int tile, int row, bool h_flip, bool v_flip) {
+	return &decodedTiles[bank][tile][h_flip][(v_flip ? 7 - row : row) * 8];
 }
 
 
-void Ppu::drawSprite(sprite_attribute* sprite, IO_map* io, priority_pixel* scanlineBuffer) {
+template <bool cgb, int output>
+void Ppu::drawSprite(sprite_attribute* sprite, IO_map* io, scanline_layer& scanlineBuffer) {
 
-	int vram_bank = _GBC_Mode && sprite->vram_bank;
+	int vram_bank = cgb && sprite->vram_bank;
 	int spriteSize = 8;
 	uint8_t tileMask = 0xff;
 	if ((io->LCDC & 0x4)) {
@@ -461,53 +830,44 @@ void Ppu::drawSprite(sprite_attribute* sprite, IO_map* io, priority_pixel* scanl
 		//for 8x16 sprite tiles the lower bit of the tile number is ignored
 		tileMask = 0xfe;
 	}
-	//vertical flip
+	//the oam can be changed after the sprites of the line were found
 	int row = io->LY - (sprite->y_pos - 16);
+	if (row < 0 || row >= spriteSize)
+		return;
+	//vertical flip
 	row = sprite->y_flip ? (spriteSize-1-row) : row;
 
 	int col = sprite->x_pos - 8;
-	uint8_t* spriteMem = &vram[vram_bank][(sprite->tile & tileMask) * 16];
-	SDL_Color pixel;
-	uint8_t color;
-	uint8_t palette = (sprite->palette ? io->OBP1 : io->OBP0);
-	
+	const uint8_t* spriteRow = tileRow(vram_bank, (sprite->tile & tileMask) + row / 8, row % 8, sprite->x_flip, false);
+	const uint32_t* colors = cgb ? &_memory->getSpriteColors()[sprite->gbc_palette * 4] : _memory->getDmgColors(1 + sprite->palette);
+	const uint8_t* indexes = cgb ? &cgbIndexes[INDEX_SPRITE + sprite->gbc_palette * 4] : _memory->getDmgShadeIndexes(1 + sprite->palette);
+	uint8_t priority = sprite->priority ? 0xff : 0;
+
 	for (int i = 0; i < 8; i++) {
-		int pixelCol = sprite->x_flip ? (7-i) : i;		//horizontal flip
 		if (col + i < 0 || col + i > 159)	//not inside the screen
 			continue;
-		uint8_t color_nr = ((spriteMem[row * 2] >> (7 - pixelCol)) & 0x1) |
-			(((spriteMem[row * 2 + 1] >> (7 - pixelCol)) << 1) & 0x2);
+		uint8_t color_nr = spriteRow[i];
 		if (color_nr == 0)		//transparent
 			continue;
 
-		if (_GBC_Mode) {
-			SDL_Color pixel = _memory->getSpriteColor(sprite->gbc_palette, color_nr);
-			//draw the pixel
-			memcpy(&scanlineBuffer[col + i].color, &pixel, 4);
-			scanlineBuffer[col + i].priority = sprite->priority;
-			scanlineBuffer[col + i].trasparent = 0;
-			continue;
-		}
-		color = (palette >> (color_nr * 2)) & 0x3;
-		pixel = dmg_palette[color];
-		memcpy(&scanlineBuffer[col + i].color, &pixel, 4);
-		scanlineBuffer[col + i].priority = sprite->priority;
-		scanlineBuffer[col + i].trasparent = 0;
+		//draw the pixel
+		if constexpr ((output & LAYER_RGBA) != 0) scanlineBuffer.color[col + i] = colors[color_nr];
+		if constexpr ((output & LAYER_INDEX) != 0) scanlineBuffer.index[col + i] = indexes[color_nr];
+		scanlineBuffer.priority[col + i] = priority;
+		scanlineBuffer.trasparent[col + i] = 0;
 	}
 }
 
-//return a copy of the buffer to render. The caller MUST NOT release the memory
+//return the last completed frame, valid until the next call. The caller MUST NOT release the memory
 const uint32_t * const Ppu::getBufferToRender() {
-	bufferMutex.lock();
-	uint32_t* buffer = screenBuffers[!activeBuffer];
-	memcpy(tempBuffer, buffer, 160 * 144 * 4);		//copy the buffer
-	bufferMutex.unlock();
+	frameDisplayed();
+	return memorySink.getFrame();
+}
 
-	if (updatePalette) {
-		updatePalette = 0;
-		if (paletteNr >= 0 && paletteNr < 3) {
-			dmg_palette = gb_palettes[paletteNr];
-		}
-	}
-	return tempBuffer;
+uint64_t Ppu::getFrameSequence() {
+	return memorySink.getFrameSequence();
+}
+
+void Ppu::frameDisplayed() {
+	framesPerFetch = framesSinceFetch.exchange(0);
 }
\ No newline at end of file
@@ -2,8 +2,10 @@
 #define PPU_H
 
 #include <cstdint>
-#include <mutex>
+#include <atomic>
 #include "structures.h"
+#include "compositor.h"
+#include "frame_sink.h"
 
 namespace {
 	SDL_Color gb_palettes[][4] = {
@@ -28,47 +30,130 @@ namespace {
 	};
 };
 
-//lookup table to revers bit order for tile horizontal flipping
-static uint8_t reverse_lookup[16] = {
-0x0, 0x8, 0x4, 0xc, 0x2, 0xa, 0x6, 0xe,
-0x1, 0x9, 0x5, 0xd, 0x3, 0xb, 0x7, 0xf, };
+//lines of a drawn frame that were not drawn again because their inputs didn't change
+struct line_reuse_stats {
+	uint32_t reused;
+	uint32_t drawn;		//all the lines, reused or not
+};
+
+//frame skip setting that drops the frames emulated between two frames shown by the renderer
+#define FRAMESKIP_AUTO -1
 
-static uint8_t color_lookup_table[32];
+//colours carried by the scanline layers. Only the ones of the enabled outputs are resolved
+enum layer_output {
+	LAYER_RGBA = 1,
+	LAYER_INDEX = 2
+};
 
 class Ppu {
 public:
 	Ppu();
 	void Init();
 	void drawScanline(int cycles);
+	int cyclesToNextEvent();
+	//Frames go to the sink, or to the ppu memory sink when it's nullptr.
+	//getBufferToRender and getFrameSequence read the memory sink
+	void setFrameSink(FrameSink* sink);
 	const uint32_t* const getBufferToRender();
+	uint64_t getFrameSequence();		//number of the frame returned by getBufferToRender, starting from 1
+	void frameDisplayed();		//called by the consumer for every frame it shows
+	//Indexed frames go to the sink as well, nullptr stops them. Without the rgba output
+	//the frames are only indexed
+	void setIndexedFrameSink(IndexedFrameSink* sink);
+	void setRgbaOutput(bool enabled);
 	void setPalette(int nr);
+	//Draw one frame every frames + 1, or FRAMESKIP_AUTO. Skipped frames keep the ppu timing,
+	//interrupts and hdma but are not drawn, and the renderer keeps the last drawn frame
+	void setFrameSkip(int frames);
+	line_reuse_stats getLineReuseStats();		//last drawn frame
+	//Draw the background and the window from the rendered tile maps instead of the tiles
+	void setTileMapCache(bool enabled);
 private:
 	void sort(sprite_attribute** buffer, int len);
-	void drawBuffer(IO_map* io);
-	void drawSprite(sprite_attribute *sprite, IO_map* io, priority_pixel* scanlineBuffer);
+	//the scanline drawing is specialized for the dmg and the cgb and for the layer outputs,
+	//so the mode and the outputs are not tested for each pixel
+	template <bool cgb, int output> void drawBuffer(IO_map* io);
+	template <bool cgb, int output> void drawSprite(sprite_attribute *sprite, IO_map* io, scanline_layer& scanlineBuffer);
+	void selectDrawBuffer();
 	//void drawBackground(IO_map* io, uint32_t* scanlineBuffer);
 	void clearScanline(IO_map* io);
 	void clearScreen();
 	void disable();
 	void enable();
-	void findScanlineBgTiles(IO_map* io);
-	std::pair <bool, int> createWindowScanline(priority_pixel *scanline, IO_map* io);
+	template <bool cgb> void findScanlineBgTiles(IO_map* io);
+	template <bool cgb, int output> std::pair <bool, int> createWindowScanline(scanline_layer& scanline, IO_map* io);
 	void findScanlineSprites(sprite_attribute* oam, IO_map* io);
-	void flipTile(background_tile& tile);
-	void createBackgroundScanline(priority_pixel* scanline, IO_map* io);
-	void createSpriteScanline(priority_pixel* scanline, IO_map* io);
-	uint8_t reverse(uint8_t n);
+	void buildSpriteIndex(sprite_attribute* oam, IO_map* io);
+	template <bool cgb, int output> void createBackgroundScanline(scanline_layer& scanline, IO_map* io);
+	template <bool cgb, int output> void createSpriteScanline(scanline_layer& scanline, IO_map* io);
+	template <bool cgb> bool reuseLine(IO_map* io);
+	template <bool cgb> uint64_t lineVramGeneration(IO_map* io);
+	template <bool cgb> uint64_t tileMapRowGeneration(uint32_t tileMapAddr, int mapRow, int firstColumn, int columns, IO_map* io);
+	void forgetLines();
+	void beginLineCopies(line_copies& copies, uint8_t* memory, int pitch, bool keepsFrames);
+	bool reuseLineCopy(line_copies& copies, uint8_t* line, int lineNr, int size);
+	void lineCopyDrawn(line_copies& copies, uint8_t* line, int lineNr, int size, bool unchanged);
+	void refreshTileCache();
+	template <bool cgb> const uint8_t* tileMapLine(int map, int y, IO_map* io);
+	template <bool cgb> void renderTileMapRow(tile_map_cache& cache, int map, int row, IO_map* io);
+	void decodeTile(int bank, int tile);
+	const uint8_t* tileRow(int bank, int tile, int row, bool h_flip, bool v_flip);
 
 	ppu_registers registers;
-	uint32_t screenBuffers[2][23040];		//screen buffers with pixel format rgba
-	uint32_t* tempBuffer;	//used to provide a copy of the buffer to render to the renderer
-	int activeBuffer;		//index of the buffer being modified
+	MemoryFrameSink memorySink;
+	FrameSink* sink;
+	uint32_t* frameBuffer;		//memory of the frame being drawn, nullptr before its first line
+	int framePitch;
+	uint32_t* frameLine(int line);
+	bool rgbaOutput;
+	IndexedFrameSink* indexedSink;
+	uint8_t* indexedBuffer;		//memory of the indexed frame being drawn, nullptr before its first line
+	int indexedPitch;
+	uint8_t* indexedLine(int line);
+	uint8_t cgbIndexes[64];		//cgb colour indexes, in the order of the palette colour tables
+	void endFrame();
 	uint8_t* vram[2];	//vram banks
-	std::mutex bufferMutex;
+
+	//tiles decoded to one colour number per pixel, in normal and horizontally mirrored order.
+	//Vertical flipping only changes the row. Refreshed from the vram change tracking
+	uint8_t decodedTiles[2][384][2][64];		//bank, tile, h flip, pixel
+	uint64_t tileCacheGeneration;		//vram generation the cache is up to date with
+
+	//tile maps 0x9800 and 0x9c00 rendered with tile data 0x8800 and 0x8000, so switching
+	//between them with the LCDC doesn't render them again. Tile rows are rendered when a line uses them
+	tile_map_cache tileMaps[2][2];		//map, tile data
+	bool tileMapCacheEnabled;
+
+	//sprites shown on each line in priority order, at most 10. Rebuilt when the oam or the sprite size changes
+	sprite_attribute* lineSprites[144][10];
+	uint8_t lineSpriteCount[144];
+	uint64_t spriteIndexGeneration;		//oam generation of the index
+	int spriteIndexSize;		//sprite height of the index, 0 when it must be rebuilt
+
+	//a line is not drawn again when its key matches and the vram it uses didn't change
+	//since it was drawn. Its content is then taken from the copies of each output
+	line_key lineKeys[144];
+	uint64_t lineDrawGeneration[144];		//vram generation when the line was drawn
+	bool lineCached[144];
+	line_copies rgbaCopies, indexedCopies;
+	uint32_t savedColors[144][160];		//lines saved for the sinks that don't keep their frames
+	uint8_t savedIndexes[144][160];
+	line_reuse_stats lineStats, lastLineStats;
+
 	SDL_Color* dmg_palette;
+	void (Ppu::*drawBufferFunc)(IO_map* io);		//drawBuffer for the emulated model and the outputs
+	compositor_func compositeFunc;		//scanline compositor for the cpu
+	index_compositor_func indexCompositeFunc;
 
 	int paletteNr;
 	bool updatePalette;
+
+	int frameSkip;
+	int skipCounter;		//frames since the last drawn one
+	bool skippingFrame;
+	std::atomic<int> framesSinceFetch;		//frames completed since the consumer showed the last one
+	std::atomic<int> framesPerFetch;
+	void startFrame();
 };
 
 #endif
@@ -0,0 +1,276 @@
+#ifdef GB_PROFILE
+
+#include "profiler.h"
+#include "structures.h"
+#include "decode_cache.h"
+#include "memory.h"
+#include "globals.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string.h>
+#include <fstream>
+#include <algorithm>
+
+//deeper calls are counted in the caller. Protects from code that never returns
+#define PROFILE_MAX_DEPTH 256
+
+//location kinds, stored in the top bits of a location. The bank is in bits 16 - 27
+#define LOCATION_ROM 0
+#define LOCATION_RAM 1
+#define LOCATION_BOOT 2
+
+Profiler::Profiler() {
+	memset(opcodeCount, 0, sizeof(opcodeCount));
+	memset(prefixedOpcodeCount, 0, sizeof(prefixedOpcodeCount));
+	haltCycles = 0;
+}
+
+void Profiler::Init(uint32_t romSize) {
+
+	for (uint32_t i = 0; i < romStats.size(); i++) {
+		free(romStats[i]);
+	}
+	romStats.assign(romSize / 0x4000, nullptr);
+	ramStats.assign(8 * 0x8000, {});
+	bootStats.assign(0x900, {});
+
+	memset(opcodeCount, 0, sizeof(opcodeCount));
+	memset(prefixedOpcodeCount, 0, sizeof(prefixedOpcodeCount));
+	haltCycles = 0;
+
+	nodes.assign(1, { 0, 0, 0 });
+	children.clear();
+	frames.assign(1, { 0, 0xffff });
+}
+
+uint32_t Profiler::location(uint16_t pc) {
+
+	if (pc < 0x8000) {
+		int32_t offset = _memory->getRomOffset(pc);
+		if (offset < 0)
+			return (LOCATION_BOOT << 28) | pc;
+		return (LOCATION_ROM << 28) | ((offset >> 14) << 16) | pc;
+	}
+	int bank = (pc >= 0xd000 && pc < 0xe000) ? _memory->getWramBank() : 0;
+	return (LOCATION_RAM << 28) | (bank << 16) | pc;
+}
+
+pc_stats& Profiler::stats(uint32_t location) {
+
+	uint16_t pc = location & 0xffff;
+	uint32_t bank = (location >> 16) & 0xfff;
+	switch (location >> 28) {
+	case LOCATION_ROM:
+		if (bank >= romStats.size())
+			romStats.resize(bank + 1, nullptr);
+		if (romStats[bank] == nullptr)
+			romStats[bank] = (pc_stats*)calloc(0x4000, sizeof(pc_stats));
+		return romStats[bank][pc & 0x3fff];
+	case LOCATION_RAM:
+		return ramStats[bank * 0x8000 + pc - 0x8000];
+	default:
+		return bootStats[pc];
+	}
+}
+
+std::string Profiler::locationName(uint32_t location) {
+
+	char name[16];
+	uint16_t pc = location & 0xffff;
+	int bank = (location >> 16) & 0xfff;
+	switch (location >> 28) {
+	case LOCATION_ROM:
+		snprintf(name, sizeof(name), "%02x:%04x", bank, pc);
+		break;
+	case LOCATION_RAM:
+		if (pc >= 0xd000 && pc < 0xe000)
+			snprintf(name, sizeof(name), "ram%d:%04x", bank, pc);
+		else
+			snprintf(name, sizeof(name), "ram:%04x", pc);
+		break;
+	default:
+		snprintf(name, sizeof(name), "boot:%04x", pc);
+	}
+	return name;
+}
+
+void Profiler::record(uint16_t pc, const decoded_instruction& instr, uint64_t hits, uint64_t m_cycles) {
+
+	pc_stats& s = stats(location(pc));
+	s.hits += hits;
+	s.cycles += m_cycles;
+	if (instr.opcode == 0xcb) {
+		s.opcode = 0x100 | (instr.operand & 0xff);
+		prefixedOpcodeCount[instr.operand & 0xff] += hits;
+	}
+	else {
+		s.opcode = instr.opcode;
+		opcodeCount[instr.opcode] += hits;
+	}
+	nodes[frames.back().node].cycles += m_cycles;
+}
+
+//called after the instruction at pc has run
+void Profiler::instruction(uint16_t pc, const decoded_instruction& instr, int m_cycles, const struct registers& regs) {
+
+	record(pc, instr, 1, m_cycles);
+
+	if (regs.pc == (uint16_t)(pc + instr.length))		//not a taken branch
+		return;
+
+	switch (instr.opcode) {
+	case 0xc4: case 0xcc: case 0xcd: case 0xd4: case 0xdc:		//CALL
+	case 0xc7: case 0xcf: case 0xd7: case 0xdf: case 0xe7: case 0xef: case 0xf7: case 0xff:		//RST
+		call(location(regs.pc), regs.sp);
+		break;
+	case 0xc0: case 0xc8: case 0xc9: case 0xd0: case 0xd8: case 0xd9:		//RET, RETI
+		ret(regs.sp);
+		break;
+	}
+}
+
+//idle loop iterations skipped by the cpu. pc is the loop start
+void Profiler::loop(uint16_t pc, const decoded_instruction* const* instructions, int length, int branchCycles, int iterations) {
+
+	for (int i = 0; i < length; i++) {
+		const decoded_instruction* instr = instructions[i];
+		uint64_t m_cycles = (uint64_t)iterations * (instr->cycles + ((i == length - 1) ? branchCycles : 0));
+		record(pc, *instr, iterations, m_cycles);
+		pc += instr->length;
+	}
+}
+
+//interrupt dispatch. sp points to the pushed pc
+void Profiler::interrupt(uint16_t vector, uint16_t sp, int m_cycles) {
+	call(location(vector), sp);
+	nodes[frames.back().node].cycles += m_cycles;
+}
+
+void Profiler::halt(int m_cycles) {
+	haltCycles += m_cycles;
+}
+
+void Profiler::call(uint32_t location, uint16_t sp) {
+
+	if (frames.size() >= PROFILE_MAX_DEPTH)
+		return;
+
+	uint32_t parent = frames.back().node;
+	uint64_t key = ((uint64_t)parent << 32) | location;
+	uint32_t node;
+	auto it = children.find(key);
+	if (it == children.end()) {
+		node = (uint32_t)nodes.size();
+		nodes.push_back({ parent, location, 0 });
+		children[key] = node;
+	}
+	else {
+		node = it->second;
+	}
+	frames.push_back({ node, sp });
+}
+
+//leaves the functions whose return address is above the stack pointer. Handles code that
+//drops return addresses from the stack or resets the stack pointer
+void Profiler::ret(uint16_t sp) {
+	while (frames.size() > 1 && frames.back().sp < sp) {
+		frames.pop_back();
+	}
+}
+
+bool Profiler::save(const std::string& reportPath, const std::string& foldedPath,
+	const opcode_info* opcodeTable, const opcode_info* prefixedOpcodeTable) {
+
+	std::ofstream report(reportPath);
+	std::ofstream folded(foldedPath);
+	if (!report || !folded) {
+		std::cout << "Warning: unable to open the profile files for writing" << std::endl;
+		return false;
+	}
+
+	//executed locations, most expensive first
+	std::vector<std::pair<uint32_t, pc_stats>> hot;
+	for (uint32_t bank = 0; bank < romStats.size(); bank++) {
+		if (romStats[bank] == nullptr)
+			continue;
+		for (int i = 0; i < 0x4000; i++) {
+			if (romStats[bank][i].hits > 0)
+				hot.push_back({ (LOCATION_ROM << 28) | (bank << 16) | ((bank == 0 ? 0 : 0x4000) + i), romStats[bank][i] });
+		}
+	}
+	for (uint32_t i = 0; i < ramStats.size(); i++) {
+		if (ramStats[i].hits > 0)
+			hot.push_back({ (LOCATION_RAM << 28) | ((i / 0x8000) << 16) | (0x8000 + i % 0x8000), ramStats[i] });
+	}
+	for (uint32_t i = 0; i < bootStats.size(); i++) {
+		if (bootStats[i].hits > 0)
+			hot.push_back({ (LOCATION_BOOT << 28) | i, bootStats[i] });
+	}
+	std::sort(hot.begin(), hot.end(), [](const std::pair<uint32_t, pc_stats>& a, const std::pair<uint32_t, pc_stats>& b) {
+		return a.second.cycles > b.second.cycles;
+	});
+
+	uint64_t instructions = 0, cycles = 0;
+	for (const auto& entry : hot) {
+		instructions += entry.second.hits;
+		cycles += entry.second.cycles;
+	}
+	uint64_t total = haltCycles;
+	for (const call_node& node : nodes) {
+		total += node.cycles;		//includes the interrupt dispatches
+	}
+	double percent = (total > 0) ? 100.0 / total : 0;
+
+	char line[128];
+	snprintf(line, sizeof(line), "%llu instructions, %llu machine cycles, %llu halted\n",
+		(unsigned long long)instructions, (unsigned long long)cycles, (unsigned long long)haltCycles);
+	report << line;
+
+	//opcodes by count
+	for (int table = 0; table < 2; table++) {
+		const uint64_t* count = (table == 0) ? opcodeCount : prefixedOpcodeCount;
+		const opcode_info* info = (table == 0) ? opcodeTable : prefixedOpcodeTable;
+		std::vector<int> order;
+		for (int i = 0; i < 256; i++) {
+			if (count[i] > 0)
+				order.push_back(i);
+		}
+		std::sort(order.begin(), order.end(), [count](int a, int b) { return count[a] > count[b]; });
+
+		report << ((table == 0) ? "\nOpcodes\n" : "\nPrefixed opcodes\n");
+		for (int op : order) {
+			snprintf(line, sizeof(line), "%14llu %6.2f%%  %s\n", (unsigned long long)count[op],
+				instructions > 0 ? count[op] * 100.0 / instructions : 0, info[op].mnemonic);
+			report << line;
+		}
+	}
+
+	report << "\nLocations by machine cycles\n";
+	for (const auto& entry : hot) {
+		const pc_stats& s = entry.second;
+		const char* mnemonic = (s.opcode & 0x100) ? prefixedOpcodeTable[s.opcode & 0xff].mnemonic : opcodeTable[s.opcode].mnemonic;
+		snprintf(line, sizeof(line), "%-12s %14llu %6.2f%% %14llu  %s\n", locationName(entry.first).c_str(),
+			(unsigned long long)s.cycles, s.cycles * percent, (unsigned long long)s.hits, mnemonic);
+		report << line;
+	}
+
+	//one line per call path with the cycles used by its last function
+	for (uint32_t i = 0; i < nodes.size(); i++) {
+		if (nodes[i].cycles == 0)
+			continue;
+		std::string path;
+		for (uint32_t n = i; n != 0; n = nodes[n].parent) {
+			path = ";" + locationName(nodes[n].location) + path;
+		}
+		folded << "main" << path << " " << nodes[i].cycles << "\n";
+	}
+	if (haltCycles > 0)
+		folded << "main;halt " << haltCycles << "\n";
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#ifdef GB_PROFILE
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+struct registers;
+struct opcode_info;
+struct decoded_instruction;
+
+//executions and machine cycles of the instruction at an address
+struct pc_stats {
+	uint64_t hits;
+	uint64_t cycles;
+	uint16_t opcode;		//0x100 | opcode for the 0xCB prefixed ones
+};
+
+//function in the guest call tree. Cycles are the ones used by the function itself
+struct call_node {
+	uint32_t parent;
+	uint32_t location;
+	uint64_t cycles;
+};
+
+//function running. sp points to its return address
+struct call_frame {
+	uint32_t node;
+	uint16_t sp;
+};
+
+//Collects per opcode and per address statistics of the executed code and builds the guest call tree
+//from CALL, RST, interrupts and RET. Locations include the rom or wram bank, so banked code is kept apart
+class Profiler {
+public:
+	Profiler();
+	void Init(uint32_t romSize);
+	void instruction(uint16_t pc, const decoded_instruction& instr, int m_cycles, const struct registers& regs);
+	void loop(uint16_t pc, const decoded_instruction* const* instructions, int length, int branchCycles, int iterations);
+	void interrupt(uint16_t vector, uint16_t sp, int m_cycles);
+	void halt(int m_cycles);
+	//sorted report and flamegraph folded stacks
+	bool save(const std::string& reportPath, const std::string& foldedPath,
+		const opcode_info* opcodeTable, const opcode_info* prefixedOpcodeTable);
+private:
+	uint64_t opcodeCount[256];
+	uint64_t prefixedOpcodeCount[256];
+	uint64_t haltCycles;
+
+	std::vector<pc_stats*> romStats;		//one array per rom bank, allocated on the first hit
+	std::vector<pc_stats> ramStats;		//0x8000 - 0xffff, one copy per wram bank
+	std::vector<pc_stats> bootStats;
+
+	std::vector<call_node> nodes;		//node 0 is the code running outside any call
+	std::unordered_map<uint64_t, uint32_t> children;		//parent node and location -> node
+	std::vector<call_frame> frames;
+
+	uint32_t location(uint16_t pc);
+	pc_stats& stats(uint32_t location);
+	std::string locationName(uint32_t location);
+	void record(uint16_t pc, const decoded_instruction& instr, uint64_t hits, uint64_t m_cycles);
+	void call(uint32_t location, uint16_t sp);
+	void ret(uint16_t sp);
+};
+
+#endif
+
+#endif
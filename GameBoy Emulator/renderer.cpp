@@ -44,6 +44,7 @@ void Renderer::Init(int width, int height) {
 	settingTabs = 0;
 	windowSizeSelectedItem = (char*)windowSizeItems[2];
 	gameSpeedSelectedItem = (char*)gameSpeedItems[2];
+	frameSkipSelectedItem = (char*)frameSkipItems[0];
 	paletteSelectedItem = (char*)paletteItems[0];
 
 	SDL_SetHint(SDL_HINT_RENDER_DRIVER, "opengl");		//needed otherwise imgui breaks when resizing the window
@@ -56,8 +57,8 @@ void Renderer::Init(int width, int height) {
 	ImGui::CreateContext();
 	ImGuiSDL::Initialize(_renderer, windowWidth, windowHeight);
 
-	windowScreen = SDL_CreateTexture(_renderer, SDL_PIXELFORMAT_ABGR8888, SDL_TEXTUREACCESS_STREAMING, 160, 144);
-	SDL_SetTextureBlendMode(windowScreen, SDL_BLENDMODE_NONE);
+	screenSink.Init(_renderer);
+	_ppu->setFrameSink(&screenSink);
 
 }
 
@@ -110,16 +111,9 @@ void Renderer::RenderFrame(double elapsedTime) {
 	SDL_SetRenderTarget(_renderer, nullptr);
 	SDL_SetRenderDrawBlendMode(this->_renderer, SDL_BLENDMODE_NONE);
 
-	//draw the buffer
-	const uint32_t* const screen = _ppu->getBufferToRender();
-	int pitch;
-	void* pixelBuffer;
-	if (SDL_LockTexture(windowScreen, nullptr, &pixelBuffer, &pitch) < 0)
-		fatal(FATAL_TEXTURE_LOCKING_FAILED, __func__);
-	memcpy(pixelBuffer, screen, 160 * 144 * 4);
-	SDL_UnlockTexture(windowScreen);
-	SDL_SetRenderTarget(_renderer, nullptr);
-	SDL_RenderCopy(_renderer, windowScreen, nullptr, nullptr);
+	//draw the last frame completed by the ppu
+	SDL_RenderCopy(_renderer, screenSink.getTexture(), nullptr, nullptr);
+	_ppu->frameDisplayed();
 
 	ImGui::Render();
 	ImGuiSDL::Render(ImGui::GetDrawData());
@@ -143,6 +137,12 @@ void Renderer::imguiFrame(float elapsed) {
 				{
 					_memory->saveCartridgeState();
 				}
+#ifdef GB_PROFILE
+				if (ImGui::MenuItem("Save profile", "F4"))
+				{
+					_gameboy->saveProfile();
+				}
+#endif
 				ImGui::EndMenu();
 			}
 			ImGui::EndMainMenuBar();
@@ -194,6 +194,21 @@ void Renderer::imguiFrame(float elapsed) {
 				}
 				ImGui::EndCombo();
 			}
+			if (ImGui::BeginCombo("Frame skip", frameSkipSelectedItem))
+			{
+				for (int n = 0; n < IM_ARRAYSIZE(frameSkipItems); n++)
+				{
+					bool is_selected = (frameSkipSelectedItem == frameSkipItems[n]);
+					if (ImGui::Selectable(frameSkipItems[n], is_selected)) {		//set new selected item
+						frameSkipSelectedItem = (char*)frameSkipItems[n];
+						_ppu->setFrameSkip(n < IM_ARRAYSIZE(frameSkipItems) - 1 ? n : FRAMESKIP_AUTO);
+					}
+					if (is_selected) {
+						ImGui::SetItemDefaultFocus();
+					}
+				}
+				ImGui::EndCombo();
+			}
 			if (ImGui::BeginCombo("Palette", paletteSelectedItem))
 			{
 				for (int n = 0; n < IM_ARRAYSIZE(paletteItems); n++)
@@ -209,6 +224,10 @@ void Renderer::imguiFrame(float elapsed) {
 				}
 				ImGui::EndCombo();
 			}
+			idle_stats idle = _gameboy->getIdleStats();
+			ImGui::Text("Idle cycles skipped: %u halted, %u polling", idle.haltCycles, idle.pollCycles);
+			line_reuse_stats lines = _ppu->getLineReuseStats();
+			ImGui::Text("Lines reused: %u of %u", lines.reused, lines.drawn);
 		}
 		else if (settingTabs == 2) {		//keyboard settings
 			ImGui::BeginTable("Keyboard map", 3);
@@ -9,6 +9,7 @@
 
 #include "structures.h"
 #include "gameboy.h"
+#include "texture_sink.h"
 
 struct IO_map;
 
@@ -16,6 +17,7 @@ namespace {
 	const char* paletteItems[] = { "Default", "Original", "Greyscale"};
 	const char* windowSizeItems[] = { "2x2", "3x3", "4x4", "5x5", "6x6" };
 	const char* gameSpeedItems[] = { "0.5x", "0.75x", "1.0x", "1.25x", "1.5x", "1.75x", "2.0x" };
+	const char* frameSkipItems[] = { "Off", "1", "2", "3", "Auto" };
 	const char* gbButtonStrings[] = {"a", "b", "start", "select", "left", "right", "up", "down"};
 }
 
@@ -37,7 +39,7 @@ private:
 	//window stuff
 	SDL_Window* _window;
 	SDL_Renderer* _renderer;
-	SDL_Texture* windowScreen;
+	TextureSink screenSink;		//the ppu draws in its textures
 
 	bool stopped;
 
@@ -54,6 +56,7 @@ private:
 	int settingTabs;
 	char* windowSizeSelectedItem;
 	char* gameSpeedSelectedItem;
+	char* frameSkipSelectedItem;
 	char* paletteSelectedItem;
 	bool showMessageBox;
 };
@@ -5,6 +5,17 @@
 #include <SDL_mixer.h>
 #include <SDL.h>
 
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define GB_BIG_ENDIAN
+#endif
+
+//register pair readable as a 16 bit value and as the two 8 bit registers
+#ifdef GB_BIG_ENDIAN
+#define REGISTER_PAIR(pair, hi, lo) union { uint16_t pair; struct { uint8_t hi, lo; }; }
+#else
+#define REGISTER_PAIR(pair, hi, lo) union { uint16_t pair; struct { uint8_t lo, hi; }; }
+#endif
+
 enum MBC_type {
 	NO_MBC,
 	MBC1,
@@ -65,8 +76,17 @@ struct background_attribute {		//attribute sprite for background (GBC mode only)
 		bg_oam_priority : 1;	//(0=Use OAM priority bit, 1=BG Priority)
 };
 
+//a tile map rendered with one byte per pixel: colour number in bits 0-1, cgb palette in bits 2-4
+//and background priority in bit 7
+struct tile_map_cache {
+	uint8_t pixels[256][256];
+	uint64_t rowGeneration[32];		//vram generation of each rendered tile row, TILE_ROW_NOT_RENDERED before
+};
+
+#define TILE_ROW_NOT_RENDERED UINT64_MAX
+
 struct background_tile {
-	uint8_t tile_mem[16];
+	const uint8_t* row;		//colour numbers of the tile row shown in the scanline, already flipped
 	background_attribute tile_attr;
 };
 
@@ -178,15 +198,36 @@ struct io_sound_noise_channel {
 
 };
 
+//how N and H are computed from the last operation
+enum flags_op {
+	FLAGS_NH,		//x holds N and H as in the F register
+	FLAGS_ADD,		//H if x + y > 0xf
+	FLAGS_SUB,		//H if x < y, N set
+	FLAGS_INC,		//H if the low nibble of the result is 0
+	FLAGS_DEC		//H if the low nibble of the result is 0xf, N set
+};
+
+//F register bits
+#define FLAG_Z 0x80
+#define FLAG_N 0x40
+#define FLAG_H 0x20
+#define FLAG_C 0x10
+
+//The flags are stored as the last operation left them, N and H are computed only
+//when the F register is read (PUSH AF, DAA). Z and C are read directly by the branches
+struct lazy_flags {
+	uint8_t result;		//Z is set if 0
+	uint8_t carry;		//C, 0 or 1
+	uint8_t op;		//flags_op
+	uint8_t x, y;		//low nibbles of the operands, y includes the carry in
+};
+
 struct registers {
-	uint8_t a, b, c, d, e, h, l;	//general purpose registers
-	struct flag {
-		uint8_t grd : 4,	//always 0
-			c : 1,		//carry
-			h : 1,		//half carry
-			n : 1,		//negative
-			z : 1;	//zero
-	}flag;
+	uint8_t a;		//accumulator. F is kept in flags, so AF is not a pair
+	REGISTER_PAIR(bc, b, c);		//general purpose registers
+	REGISTER_PAIR(de, d, e);
+	REGISTER_PAIR(hl, h, l);
+	struct lazy_flags flags;
 	uint16_t	pc,		//program counter
 				sp;		//stack pointer
 
@@ -203,11 +244,36 @@ struct registers {
 	uint64_t clock_cnt;
 };
 
-struct priority_pixel {
-	uint32_t color;
-	uint8_t priority : 1,
-		trasparent : 1,
-		not_used : 6;
+//one layer of a scanline, stored by component so the compositor can process several pixels at once.
+//The flags are 0xff when set and 0 otherwise. The colours are written only for the enabled outputs
+struct scanline_layer {
+	uint32_t color[160];
+	uint8_t index[160];		//colour in the indexed frame
+	uint8_t priority[160];
+	uint8_t trasparent[160];
+};
+
+//inputs of a drawn line, other than the vram content
+struct line_key {
+	uint64_t paletteGeneration;
+	uint8_t LCDC, SCX, SCY, WX, WY;
+	uint8_t spriteCount;
+	sprite_attribute sprites[10];		//in priority order
+};
+
+//sink buffers tracked for each output, then the copy saved by the ppu
+#define LINE_COPY_BUFFERS 4
+#define LINE_COPY_SAVED LINE_COPY_BUFFERS
+
+//where the last drawn content of the lines of an output can be found. The buffers of a sink
+//that keeps its frames are tracked, so a line that didn't change is left as it is or copied
+//from another buffer. With other sinks the lines drawn again unchanged are saved by the ppu
+struct line_copies {
+	uint8_t* memory[LINE_COPY_BUFFERS + 1];		//first line of each copy, nullptr when not tracked
+	int pitch[LINE_COPY_BUFFERS + 1];		//in bytes
+	int current;		//buffer of the frame being drawn, -1 when the sink doesn't keep its frames
+	int nextBuffer;		//replaced by the next frame memory not tracked yet
+	uint8_t valid[144];		//mask of the copies with the last drawn content of each line
 };
 
 struct ppu_registers {
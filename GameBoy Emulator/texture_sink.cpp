@@ -0,0 +1,41 @@
+#include "texture_sink.h"
+#include "errors.h"
+
+#include <string.h>
+
+TextureSink::TextureSink() {
+	textures[0] = textures[1] = nullptr;
+	writeTexture = 0;
+}
+
+void TextureSink::Init(SDL_Renderer* renderer) {
+	for (int i = 0; i < 2; i++) {
+		textures[i] = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ABGR8888, SDL_TEXTUREACCESS_STREAMING, 160, 144);
+		SDL_SetTextureBlendMode(textures[i], SDL_BLENDMODE_NONE);
+
+		//the locked memory has no defined content, so the textures start black
+		int pitch;
+		uint32_t* pixels = beginFrame(pitch);
+		for (int line = 0; line < 144; line++) {
+			memset(&pixels[line * pitch], 0, 160 * 4);
+		}
+		endFrame();
+	}
+}
+
+uint32_t* TextureSink::beginFrame(int& pitch) {
+	void* pixels;
+	if (SDL_LockTexture(textures[writeTexture], nullptr, &pixels, &pitch) < 0)
+		fatal(FATAL_TEXTURE_LOCKING_FAILED, __func__);
+	pitch /= 4;		//bytes to pixels
+	return (uint32_t*)pixels;
+}
+
+void TextureSink::endFrame() {
+	SDL_UnlockTexture(textures[writeTexture]);
+	writeTexture = !writeTexture;
+}
+
+SDL_Texture* TextureSink::getTexture() {
+	return textures[!writeTexture];
+}
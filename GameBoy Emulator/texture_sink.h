@@ -0,0 +1,24 @@
+#ifndef TEXTURE_SINK_H
+#define TEXTURE_SINK_H
+
+#include <SDL.h>
+#include <cstdint>
+
+#include "frame_sink.h"
+
+//The ppu draws straight into the memory of a locked streaming texture. Two textures are used,
+//so the renderer always has a complete frame while the other one is locked.
+//Must be used by the thread that owns the SDL renderer
+class TextureSink : public FrameSink {
+public:
+	TextureSink();
+	void Init(SDL_Renderer* renderer);
+	uint32_t* beginFrame(int& pitch) override;
+	void endFrame() override;
+	SDL_Texture* getTexture();		//last completed frame
+private:
+	SDL_Texture* textures[2];
+	int writeTexture;		//texture of the frame being drawn
+};
+
+#endif